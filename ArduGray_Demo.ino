@@ -14,5 +14,6 @@ void loop()
 void setup()
 {  
     a.boot();
+    render_setup();
     a.startGray();
 }
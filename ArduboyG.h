@@ -30,11 +30,91 @@ Optional Configuration Macros (define before including ArduboyG.h):
     - ABG_L3_CONVERT_DARKEN
         Convert light gray to gray and dark gray to black
     
+    With ABG_Mode::Runtime, these macros only select the initial
+    conversion, which setMode() can change.
+    
     When using L3 or L4_Triplane, allow per-plane contrast adjustment,
     which can improve contrast between different shades of gray but
     usually makes the whole image darker.
     - ABG_PLANE_CONTRAST
 
+    Collect per-plane timing statistics (render time, idle time and
+    missed ISR periods), available through getProfile(). Statistics
+    are published every ABG_PROFILE_WINDOW planes (default 64, max 255).
+    - ABG_PROFILE
+
+    Record every frame ISR in a lock-free ring of ABG_EVENT_RING_SIZE
+    entries (default 8, a power of 2), each holding the ISR's latency in
+    timer ticks, a sequence number and the phase or L8_Binary event. The
+    ISR is the only writer and waitForNextPlane() the only reader, so
+    neither side disables interrupts. waitForNextPlane() drains the ring
+    into eventStats() (skipped periods, dropped events, worst latency) and
+    passes each event to the handler set with setEventHandler(), if any.
+    - ABG_EVENTS
+
+    Record a timeline into a RAM ring of ABG_TRACE_SIZE entries (default
+    64, a power of 2 up to 256, 4 bytes each), overwriting the oldest.
+    Each entry is timestamped in timer ticks and marks a frame ISR, a
+    waitForNextPlane() wakeup, the start or end of doDisplay() or of a
+    paint, or the start or end of a user span marked with traceBegin()
+    and traceEnd(). traceDump() prints the ring to a Print such as Serial,
+    and bench/abg_trace.py turns the dump into Chrome trace JSON, where
+    the single slow plane that averages hide shows up. For example:
+        a.traceBegin(1);
+        render();
+        a.traceEnd(1);
+    - ABG_TRACE
+
+    Automatically shed load when render() overruns the plane period,
+    detected as the frame ISR having already fired when waitForNextPlane()
+    is entered. The first step halves the update rate through
+    update_every_n. For L4_Triplane without an L3 conversion, the second
+    step switches to the ABG_L3_CONVERT_MIX plane sequence at the next
+    frame boundary, keeping the halved update rate. Each step is restored
+    after ABG_GOVERNOR_RESTORE consecutive planes (default 128) finish in
+    the first 3/4 of the plane period. After stepping down, the governor
+    waits ABG_GOVERNOR_HOLD planes (default 16) before stepping down
+    again. The current step is available through governorLevel().
+    - ABG_GOVERNOR
+
+    Render each plane in two bands of 4 pages into a 512-byte buffer,
+    so Arduboy2's 1024-byte sBuffer can be dropped by the linker. The
+    main loop is unchanged but runs once per band: waitForNextPlane()
+    returns for the bottom band (bandY() == 32), then for the top band
+    (bandY() == 0). The bottom band is sent once the display has scanned
+    past it, halfway through the period, and the top band at the frame
+    ISR. Only SpritesU with SPRITESU_BAND draws into the band buffer, and
+    boot() must be used instead of begin(). Requires ABG_SYNC_PARK_ROW.
+    - ABG_BANDS
+
+    Composite an overlay layer set with setOverlay() into the bytes sent
+    to the display, using the cycles paint() otherwise spends waiting on
+    SPI. The overlay costs no render time and render() cannot draw over
+    it. With OLED_SH1106 or LCD_ST7565, it is instead composited into the
+    buffer just before painting.
+    - ABG_OVERLAY
+
+    Allow setClearPattern() to replace the clear color with one byte per
+    buffer page and plane. Each byte is the 8-pixel vertical pattern the
+    page is cleared to, written in the store slot of paint(), so dithered
+    gradients or per-band background shades cost no render time.
+    - ABG_CLEAR_PATTERN
+
+    Show only the bottom ABG_VIEWPORT_PAGES pages (2 to 7) of the screen,
+    leaving the rows above dark. The display scans just those rows with a
+    reduced mux ratio, so it refreshes 8 / ABG_VIEWPORT_PAGES times as
+    fast (the default ABG_REFRESH_HZ scales to match), and only those
+    pages are painted. SpritesU draws in viewport coordinates, with
+    y = 0 at the top of the viewport, and clips to its height. Arduboy2
+    drawing methods keep full-screen coordinates. Requires
+    ABG_SYNC_PARK_ROW, and the park row is the bottom row of the viewport.
+    - ABG_VIEWPORT_PAGES
+
+    Allow setRefreshHz() to lower the refresh rate at runtime, trading
+    refresh rate for render time per plane. Without it the timer period
+    is a compile-time constant of ABG_REFRESH_HZ.
+    - ABG_RUNTIME_REFRESH
+
 Default Template Configuration:
     
     ArduboyGBase a;
@@ -48,7 +128,37 @@ Custom Template Configuration:
 
     ArduboyGBase_Config<ABG_Mode::L3, ABG_Flags:None> a;
     ArduboyG_Config    <ABG_Mode::L3, ABG_Flags:None> a;
-                    
+
+Binary-Weighted Planes:
+
+    ArduboyGBase_Config<ABG_Mode::L8_Binary> a;
+    
+    Three planes are shown for 1, 2 and 4 refresh periods, so each plane
+    is one bit of an 8-level shade: colors range from 0 (black) to 7
+    (white), and the named colors such as WHITE do not apply. Sprites
+    converted with 8 shades by convert_sprite.py hold the three planes as
+    consecutive frames. Requires ABG_SYNC_PARK_ROW. The frame ISR only
+    flags that the display should park before each new plane, and
+    waitForNextPlane() sends the park command, so the ISR never uses SPI
+    and render() may (e.g., ArduboyFX). A render() that runs into the
+    last refresh of its plane parks late, showing the plane for part of
+    an extra frame.
+
+Runtime Mode Selection:
+
+    ArduboyGBase_Config<ABG_Mode::Runtime> a;
+    
+    a.setMode(ABG_Mode::L4_Triplane);
+    a.setMode(ABG_Mode::L4_Triplane, ABG_Convert::Mix);
+    
+    The mode starts as L3 and setMode() takes effect at the next frame
+    boundary. L8_Binary cannot be selected at runtime. Plane colors come
+    from a table lookup instead of being folded at compile time, so only
+    use this when switching is needed. As in the fixed modes, updates are
+    counted once per frame, so every plane of a frame shows the same game
+    state: setUpdateEveryN(n) updates every n frames, and setUpdateHz()
+    is reapplied for the new number of planes when the mode changes.
+
 Example Usage:
 
     #define ABG_IMPLEMENTATION
@@ -105,7 +215,84 @@ Example Usage:
 
 #include <Arduboy2.h>
 
+#if defined(ARDUINO_ARCH_AVR)
 #include <avr/sleep.h>
+#else
+// Host builds paint through Display_Host. The AVR registers used outside
+// the display backends become plain variables, the frame ISR becomes an
+// ordinary function, and sleeping runs it, so each wait in
+// waitForNextPlane() advances one timer period.
+#if !defined(F_CPU)
+#define F_CPU 16000000UL
+#endif
+#if !defined(PROGMEM)
+#define PROGMEM
+#endif
+#if !defined(pgm_read_byte)
+#define pgm_read_byte(p) (*(uint8_t const*)(p))
+#endif
+#if !defined(_BV)
+#define _BV(b) (1 << (b))
+#endif
+#if !defined(bitWrite)
+#define bitWrite(v, b, x) ((x) ? ((v) |= _BV(b)) : ((v) &= ~_BV(b)))
+#endif
+namespace abg_host
+{
+extern uint8_t  sreg;
+extern uint8_t  tc4h;
+extern uint8_t  control; // TCCRnx, TIMSKn and TIFRn
+extern uint16_t tcnt;
+extern uint16_t ocr;
+void sleep_cpu();
+}
+#define SREG    abg_host::sreg
+#define TCNT1   abg_host::tcnt
+#define TCNT3   abg_host::tcnt
+#define TCNT4   abg_host::tcnt
+#define OCR1A   abg_host::ocr
+#define OCR3A   abg_host::ocr
+#define OCR4C   abg_host::ocr
+#define TC4H    abg_host::tc4h
+#define TCCR1A  abg_host::control
+#define TCCR1B  abg_host::control
+#define TCCR3A  abg_host::control
+#define TCCR3B  abg_host::control
+#define TCCR4A  abg_host::control
+#define TCCR4B  abg_host::control
+#define TCCR4C  abg_host::control
+#define TCCR4D  abg_host::control
+#define TIMSK1  abg_host::control
+#define TIMSK3  abg_host::control
+#define TIMSK4  abg_host::control
+#define TIFR1   abg_host::control
+#define TIFR3   abg_host::control
+#define TIFR4   abg_host::control
+#define WGM10   0
+#define WGM11   1
+#define WGM12   3
+#define WGM13   4
+#define CS10    0
+#define CS11    1
+#define WGM30   0
+#define WGM31   1
+#define WGM32   3
+#define WGM33   4
+#define CS30    0
+#define CS31    1
+#define OCIE1A  1
+#define OCIE3A  1
+#define OCF1A   1
+#define OCF3A   1
+#define TOIE4   2
+#define TOV4    2
+#define cli() ((void)0)
+#define sei() ((void)0)
+#define sleep_enable() ((void)0)
+#define sleep_disable() ((void)0)
+#define sleep_cpu() abg_host::sleep_cpu()
+#define ISR(vector) extern "C" void vector()
+#endif
 
 #if !defined(ABG_SYNC_THREE_PHASE) && \
     !defined(ABG_SYNC_PARK_ROW) && \
@@ -126,19 +313,30 @@ Example Usage:
 #define ABG_UPDATE_EVERY_N_DENOM_DEFAULT 1
 #endif
 
+#if defined(ABG_VIEWPORT_PAGES)
+#if !defined(ABG_SYNC_PARK_ROW)
+#error "ABG_VIEWPORT_PAGES requires ABG_SYNC_PARK_ROW"
+#endif
+#if ABG_VIEWPORT_PAGES < 2 || ABG_VIEWPORT_PAGES > 7
+#error "ABG_VIEWPORT_PAGES must be from 2 to 7"
+#endif
+#if defined(ABG_BANDS)
+#error "ABG_VIEWPORT_PAGES cannot be used with ABG_BANDS"
+#endif
+#endif
+
 #if !defined(ABG_REFRESH_HZ)
 #if defined(OLED_SH1106)
-#define ABG_REFRESH_HZ 120
+#define ABG_REFRESH_HZ_FULL 120
 #else
-#define ABG_REFRESH_HZ 156
+#define ABG_REFRESH_HZ_FULL 156
 #endif
+#if defined(ABG_VIEWPORT_PAGES)
+// fewer rows scanned per display frame
+#define ABG_REFRESH_HZ (ABG_REFRESH_HZ_FULL * 8 / ABG_VIEWPORT_PAGES)
+#else
+#define ABG_REFRESH_HZ ABG_REFRESH_HZ_FULL
 #endif
-
-#if defined(ABG_UPDATE_HZ_DEFAULT)
-#undef ABG_UPDATE_EVERY_N_DEFAULT
-#undef ABG_UPDATE_EVERY_N_DENOM_DEFAULT
-#define ABG_UPDATE_EVERY_N_DEFAULT (ABG_REFRESH_HZ / 3)
-#define ABG_UPDATE_EVERY_N_DENOM_DEFAULT ABG_UPDATE_HZ_DEFAULT
 #endif
 
 #if !defined(ABG_CONTRAST_DEFAULT)
@@ -174,122 +372,1094 @@ Example Usage:
 #define ABG_L4_TRIPLANE_PLANE_LIMIT 3
 #endif
 
+#if defined(ABG_L3_CONVERT_LIGHTEN)
+#define ABG_CONVERT_DEFAULT ABG_Convert::Lighten
+#elif defined(ABG_L3_CONVERT_MIX)
+#define ABG_CONVERT_DEFAULT ABG_Convert::Mix
+#elif defined(ABG_L3_CONVERT_DARKEN)
+#define ABG_CONVERT_DEFAULT ABG_Convert::Darken
+#else
+#define ABG_CONVERT_DEFAULT ABG_Convert::None
+#endif
+
 #if defined(ABG_PLANE_CONTRAST)
 // nothing yet
 #endif
-
-#undef BLACK
-#undef WHITE
-constexpr uint8_t BLACK      = 0;
-constexpr uint8_t DARK_GRAY  = 1;
-constexpr uint8_t DARK_GREY  = 1;
-constexpr uint8_t GRAY       = 1;
-constexpr uint8_t GREY       = 1;
-constexpr uint8_t LIGHT_GRAY = 2;
-constexpr uint8_t LIGHT_GREY = 2;
-constexpr uint8_t WHITE      = 3;
-    
-enum class ABG_Mode : uint8_t
-{
-    L4_Contrast,
-    L4_Triplane,
-    L3,
+
+#if defined(ABG_PROFILE) && !defined(ABG_PROFILE_WINDOW)
+#define ABG_PROFILE_WINDOW 64
+#endif
+
+#if defined(ABG_EVENTS) && !defined(ABG_EVENT_RING_SIZE)
+#define ABG_EVENT_RING_SIZE 8
+#endif
+
+#if defined(ABG_TRACE) && !defined(ABG_TRACE_SIZE)
+#define ABG_TRACE_SIZE 64
+#endif
+
+#if defined(ABG_BANDS) && !defined(ABG_SYNC_PARK_ROW)
+#error "ABG_BANDS requires ABG_SYNC_PARK_ROW"
+#endif
+
+#if defined(ABG_GOVERNOR)
+#if !defined(ABG_GOVERNOR_RESTORE)
+#define ABG_GOVERNOR_RESTORE 128
+#endif
+#if !defined(ABG_GOVERNOR_HOLD)
+#define ABG_GOVERNOR_HOLD 16
+#endif
+#endif
+
+#undef BLACK
+#undef WHITE
+constexpr uint8_t BLACK      = 0;
+constexpr uint8_t DARK_GRAY  = 1;
+constexpr uint8_t DARK_GREY  = 1;
+constexpr uint8_t GRAY       = 1;
+constexpr uint8_t GREY       = 1;
+constexpr uint8_t LIGHT_GRAY = 2;
+constexpr uint8_t LIGHT_GREY = 2;
+constexpr uint8_t WHITE      = 3;
+    
+enum class ABG_Mode : uint8_t
+{
+    L4_Contrast,
+    L4_Triplane,
+    L3,
+    L8_Binary,
+    
+    // one of L4_Contrast, L4_Triplane or L3, selected with setMode()
+    Runtime,
+    
+    Default = L3,
+};
+
+// L3 conversions of L4_Triplane, see ABG_L3_CONVERT_*
+enum class ABG_Convert : uint8_t
+{
+    None,
+    Lighten,
+    Mix,
+    Darken,
+};
+
+struct ABG_Flags
+{
+    enum
+    {
+        None = 0,
+        
+        Default =
+            0,
+    };
+};
+
+// Timing statistics collected with ABG_PROFILE. Times are in microseconds,
+// saturating at 65535, and cover the last ABG_PROFILE_WINDOW planes,
+// except missed, which is a running total.
+struct ABG_Profile
+{
+    uint16_t render_min;
+    uint16_t render_avg;
+    uint16_t render_max;
+    uint8_t  idle_percent; // share of plane time spent in waitForNextPlane
+    uint16_t missed;       // ISR periods that passed without a doDisplay
+};
+
+// A frame ISR, recorded with ABG_EVENTS.
+struct ABG_Event
+{
+    uint16_t latency; // timer ticks from the timer event to the ISR
+    uint8_t  seq;     // ISR count, wrapping at 256
+    uint8_t  id;      // phase (ABG_SYNC_THREE_PHASE) or L8_Binary event,
+                      // plus ABG_EVENT_DISPLAY
+};
+
+// set in ABG_Event::id when the ISR requested a doDisplay
+constexpr uint8_t ABG_EVENT_DISPLAY = 0x80;
+
+// Running totals over the events drained by waitForNextPlane().
+struct ABG_EventStats
+{
+    uint16_t skipped;     // display ISRs coalesced into an earlier doDisplay
+    uint16_t dropped;     // events lost to a full ring
+    uint16_t latency_max; // worst ISR latency in timer ticks
+};
+
+#ifdef __GNUC__
+#define ABG_NOT_SUPPORTED __attribute__((error( \
+    "This method cannot be called when using ArduboyG.")))
+#else
+// will still cause linker error
+#define ABG_NOT_SUPPORTED
+#endif
+
+namespace abg_detail
+{
+
+static constexpr uint8_t num_planes(ABG_Mode mode)
+{
+    return
+        mode == ABG_Mode::L4_Contrast ? 2 :
+        mode == ABG_Mode::L4_Triplane ? 3 :
+        mode == ABG_Mode::L3          ? 2 :
+        mode == ABG_Mode::L8_Binary   ? 3 :
+        1;
+}
+
+// refresh periods per frame
+static constexpr uint8_t frame_periods(ABG_Mode mode)
+{
+    return mode == ABG_Mode::L8_Binary ? 7 : num_planes(mode);
+}
+
+#if defined(ABG_TIMER3) || defined(ABG_TIMER1)
+static constexpr uint16_t timer_counter_for(uint16_t hz)
+{
+    return uint16_t(F_CPU / 64 / hz);
+}
+// lowest rate whose counter fits the 16-bit timer
+constexpr uint8_t refresh_hz_min = F_CPU / 64 / 0xffff + 1;
+#elif defined(ABG_TIMER4)
+static constexpr uint16_t timer_counter_for(uint16_t hz)
+{
+    return uint16_t(F_CPU / 256 / hz);
+}
+// lowest rate whose counter fits the 10-bit timer
+constexpr uint8_t refresh_hz_min = F_CPU / 256 / 0x3ff + 1;
+#endif
+#if defined(ABG_OVERLAY)
+extern uint8_t const* overlay_data;
+extern uint8_t overlay_x;
+extern uint8_t overlay_page;
+extern uint8_t overlay_w;
+extern uint8_t overlay_pages;
+extern bool    overlay_progmem;
+#endif
+
+#if defined(ABG_CLEAR_PATTERN)
+extern uint8_t const* clear_pattern;
+extern uint8_t const* clear_row;
+#endif
+
+#if defined(ABG_BANDS)
+extern uint8_t band_buffer[512];
+extern uint8_t band_y; // top row of the band being rendered
+#endif
+
+#if defined(ABG_RUNTIME_REFRESH)
+// set by setRefreshHz() and read by the frame ISR
+extern uint16_t timer_counter;
+extern uint16_t refresh_hz;
+#else
+constexpr uint16_t timer_counter = timer_counter_for(ABG_REFRESH_HZ);
+constexpr uint16_t refresh_hz = ABG_REFRESH_HZ;
+#endif
+extern uint8_t  update_hz;
+extern uint8_t  contrast;
+extern uint8_t  plane_contrast_L4[3];
+extern uint8_t  plane_contrast_L3[2];
+extern uint8_t  update_counter;
+extern uint8_t  update_every_n;
+extern uint8_t  update_every_n_denom;
+extern uint8_t  current_plane;
+#if defined(ABG_SYNC_THREE_PHASE)
+extern uint8_t volatile current_phase;
+#endif
+extern bool volatile needs_display;
+
+#if defined(ABG_GOVERNOR)
+extern uint8_t  governor_level;
+extern uint8_t  governor_headroom;
+extern uint8_t  governor_hold;
+extern uint8_t  governor_update_every_n;
+#endif
+
+// Plane sequence state for ABG_Mode::Runtime and ABG_GOVERNOR. The
+// requested values are applied at the next frame boundary.
+extern ABG_Mode    runtime_mode;
+extern ABG_Mode    requested_mode;
+extern ABG_Convert requested_convert;
+extern ABG_Convert plane_convert;
+extern uint8_t     plane_limit;
+
+#if defined(ABG_SYNC_PARK_ROW)
+// ABG_Mode::L8_Binary ISR schedule. Plane p is shown for 2^p periods:
+// its display ISR starts the plane, hold ISRs fill the time, and a park
+// ISR half a period before the next display ISR sets binary_park_pending
+// for the main loop to park the display at the end of the frame being
+// scanned.
+constexpr uint8_t binary_display = 0x01;
+constexpr uint8_t binary_park    = 0x02;
+constexpr uint8_t binary_half    = 0x80; // half period follows this ISR
+constexpr uint8_t binary_events  = 10;
+extern bool binary_planes;
+extern uint8_t volatile binary_index;
+extern uint8_t volatile binary_plane;
+extern bool volatile binary_park_pending;
+
+// bits 2-3 hold the plane started by a display ISR
+inline uint8_t binary_event(uint8_t i)
+{
+    static uint8_t const EVENTS[binary_events] PROGMEM =
+    {
+        binary_display | (0 << 2) | binary_half,
+        binary_park                | binary_half,
+        binary_display | (1 << 2),
+                                     binary_half,
+        binary_park                | binary_half,
+        binary_display | (2 << 2),
+        0,
+        0,
+                                     binary_half,
+        binary_park                | binary_half,
+    };
+    return pgm_read_byte(&EVENTS[i]);
+}
+
+// timer TOP for the period that follows ISR i
+inline uint16_t binary_top(uint8_t i)
+{
+    return (binary_event(i) & binary_half) ? (timer_counter >> 1) : timer_counter;
+}
+
+uint16_t binary_isr_();
+#endif
+
+// Timer ticks since the last frame ISR. Call with interrupts disabled:
+// the ISR writes 16-bit timer registers, which share the TEMP register.
+inline uint16_t timer_count()
+{
+#if defined(ABG_TIMER3)
+    return TCNT3;
+#elif defined(ABG_TIMER1)
+    return TCNT1;
+#elif defined(ABG_TIMER4)
+    uint8_t tl = TCNT4;
+    return (uint16_t(TC4H) << 8) | tl;
+#endif
+}
+
+#if defined(ABG_EVENTS)
+static_assert((ABG_EVENT_RING_SIZE & (ABG_EVENT_RING_SIZE - 1)) == 0 &&
+    ABG_EVENT_RING_SIZE >= 2 && ABG_EVENT_RING_SIZE <= 128,
+    "ABG_EVENT_RING_SIZE must be a power of 2 from 2 to 128");
+constexpr uint8_t event_mask = ABG_EVENT_RING_SIZE - 1;
+extern ABG_Event event_ring[ABG_EVENT_RING_SIZE];
+extern uint8_t volatile event_head; // written only by the frame ISR
+extern uint8_t volatile event_tail; // written only by waitForNextPlane
+extern uint8_t event_seq;
+extern uint8_t event_next_seq;
+extern ABG_EventStats event_stats;
+extern void (*event_handler)(ABG_Event const&);
+
+// Called at the start of the frame ISR. A full ring drops the event,
+// which shows up as a gap in seq.
+inline void event_push_()
+{
+    uint16_t t = timer_count();
+    uint8_t id = ABG_EVENT_DISPLAY;
+#if defined(ABG_SYNC_THREE_PHASE)
+    id |= current_phase >= 3 ? 1 : current_phase + 1;
+#elif defined(ABG_SYNC_PARK_ROW)
+    if(binary_planes)
+    {
+        uint8_t i = binary_index + 1;
+        if(i >= binary_events) i = 0;
+        id = i;
+        if(binary_event(i) & binary_display)
+            id |= ABG_EVENT_DISPLAY;
+    }
+#endif
+    uint8_t s = event_seq++;
+    uint8_t h = event_head;
+    uint8_t n = (h + 1) & event_mask;
+    if(n == event_tail)
+        return;
+    ABG_Event& e = event_ring[h];
+    e.latency = t;
+    e.seq = s;
+    e.id = id;
+    // the entry must be written before the head publishes it
+    asm volatile("" ::: "memory");
+    event_head = n;
+}
+#endif
+
+#if defined(ABG_PROFILE) || defined(ABG_TRACE)
+#if defined(ABG_TIMER3) || defined(ABG_TIMER1)
+constexpr uint8_t timer_tick_us = 64000000ul / F_CPU;
+#elif defined(ABG_TIMER4)
+constexpr uint8_t timer_tick_us = 256000000ul / F_CPU;
+#endif
+extern uint16_t volatile profile_ticks;
+#if defined(ABG_PROFILE)
+extern ABG_Profile profile_stats;
+extern uint8_t  volatile profile_isrs;
+extern uint16_t profile_display_end;
+
+void profile_plane_(uint16_t render, uint16_t idle, uint16_t total);
+#endif
+
+// Length in timer ticks of the period that started at the last ISR.
+// OCR writes are double buffered, so it was programmed one ISR earlier.
+inline uint16_t profile_period()
+{
+#if defined(ABG_SYNC_THREE_PHASE)
+    if(current_phase != 3)
+        return (timer_counter >> 4) + 2;
+#endif
+#if defined(ABG_SYNC_PARK_ROW)
+    if(binary_planes)
+        return binary_top(binary_index) + 1;
+#endif
+    return timer_counter + 1;
+}
+
+// Timer ticks since an arbitrary epoch, wrapping at 16 bits.
+inline uint16_t profile_now()
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t t = timer_count();
+#if defined(ABG_TIMER3)
+    bool wrapped = (TIFR3 & _BV(OCF3A)) != 0;
+#elif defined(ABG_TIMER1)
+    bool wrapped = (TIFR1 & _BV(OCF1A)) != 0;
+#elif defined(ABG_TIMER4)
+    bool wrapped = (TIFR4 & _BV(TOV4)) != 0;
+#endif
+    // the counter wrapped but its ISR has not run yet
+    if(wrapped && t < (timer_counter >> 5))
+        t += profile_period();
+    t += profile_ticks;
+    SREG = sreg;
+    return t;
+}
+#endif
+
+#if defined(ABG_TRACE)
+static_assert((ABG_TRACE_SIZE & (ABG_TRACE_SIZE - 1)) == 0 &&
+    ABG_TRACE_SIZE >= 2 && ABG_TRACE_SIZE <= 256,
+    "ABG_TRACE_SIZE must be a power of 2 from 2 to 256");
+constexpr uint8_t trace_mask = ABG_TRACE_SIZE - 1;
+
+// Trace entry kinds, ORed with trace_end for the end of a span. The
+// numbering is shared with bench/abg_trace.py.
+constexpr uint8_t trace_isr     = 1; // arg: phase or L8_Binary event, as ABG_Event
+constexpr uint8_t trace_wake    = 2; // arg: 0
+constexpr uint8_t trace_display = 3; // arg: current plane, so the next
+                                      // plane for the end of the span
+constexpr uint8_t trace_paint   = 4; // arg: page count << 4 | first page
+constexpr uint8_t trace_user    = 5; // arg: id passed to traceBegin()
+constexpr uint8_t trace_end     = 0x80;
+
+struct trace_entry
+{
+    uint16_t time; // timer ticks, as profile_now()
+    uint8_t  kind; // 0 for an entry not yet written
+    uint8_t  arg;
+};
+extern trace_entry trace_ring[ABG_TRACE_SIZE];
+extern uint8_t trace_index;  // next entry to write
+extern bool    trace_paused; // set by traceDump()
+
+// Call with interrupts disabled.
+inline void trace_write_(uint16_t time, uint8_t kind, uint8_t arg)
+{
+    if(trace_paused)
+        return;
+    uint8_t i = trace_index;
+    trace_entry& e = trace_ring[i];
+    e.time = time;
+    e.kind = kind;
+    e.arg = arg;
+    trace_index = (i + 1) & trace_mask;
+}
+
+// Called from the frame ISR after profile_ticks has advanced to this ISR.
+inline void trace_isr_()
+{
+    uint8_t arg = 0;
+#if defined(ABG_SYNC_THREE_PHASE)
+    arg = current_phase >= 3 ? 1 : current_phase + 1;
+#elif defined(ABG_SYNC_PARK_ROW)
+    if(binary_planes)
+    {
+        arg = binary_index + 1;
+        if(arg >= binary_events) arg = 0;
+    }
+#endif
+    trace_write_(profile_ticks + timer_count(), trace_isr, arg);
+}
+
+inline void trace_(uint8_t kind, uint8_t arg)
+{
+    uint8_t sreg = SREG;
+    cli();
+    trace_write_(profile_now(), kind, arg);
+    SREG = sreg;
+}
+#endif
+
+template<class T>
+inline uint8_t pgm_read_byte_inc(T const*& p)
+{
+#if defined(ARDUINO_ARCH_AVR)
+    uint8_t r;
+    asm volatile("lpm %[r], %a[p]+\n" : [p] "+&z" (p), [r] "=&r" (r));
+    return r;
+#else
+    return pgm_read_byte(p++);
+#endif
+}
+template<class T>
+inline uint8_t deref_inc(T const*& p)
+{
+#if defined(ARDUINO_ARCH_AVR)
+    uint8_t r;
+    asm volatile("ld %[r], %a[p]+\n" : [p] "+&e" (p), [r] "=&r" (r) :: "memory");
+    return r;
+#else
+    return *p++;
+#endif
+}
+
+void send_cmds_(uint8_t const* d, uint8_t n);
+void send_cmds_prog_(uint8_t const* d, uint8_t n);
+
+template<uint8_t... CMDS> void send_cmds_prog()
+{
+    static uint8_t const CMDS_[] PROGMEM = { CMDS... };
+    send_cmds_prog_(CMDS_, sizeof(CMDS_));
+}
+
+inline void send_cmds_helper() {}
+
+template<class... CMDS>
+inline void send_cmds_helper(uint8_t first, CMDS... rest)
+{
+    Arduboy2Base::SPItransfer(first);
+    send_cmds_helper(rest...);
+}
+
+template<class... CMDS> inline void send_cmds(CMDS... cmds)
+{
+#if 1
+    uint8_t const CMDS_[] = { cmds... };
+    send_cmds_(CMDS_, sizeof(CMDS_));
+#else
+    Arduboy2Base::LCDCommandMode();
+    send_cmds_helper(cmds...);
+    Arduboy2Base::LCDDataMode();
+#endif
+}
+
+// Display controller backends. Each owns the controller's start
+// commands, page addressing and paint kernels, and ArduboyG_Common only
+// reaches them through abg_detail::Display, so a controller is added or
+// tuned in one place. The backend is selected at compile time by
+// OLED_SH1106 and LCD_ST7565, and on hosts without ARDUINO_ARCH_AVR,
+// Display_Host captures the painted bytes to memory.
+//
+// paint(image, clear, pages, mask) sends the buffer pages in reverse,
+// with SPI DORD set to mirror each byte, ANDing each byte with mask:
+//   clear: low byte is whether to clear, high byte is clear color
+//   pages: low byte is page count, high byte is the starting GDDRAM page
+//          (used only by page-addressed controllers)
+// paintPattern() clears each page to its byte of row instead.
+//
+// paint() is synchronous by design. At F_CPU/2, a byte takes 16 cycles
+// on SPI, which is less than the cost of entering and leaving an SPI
+// interrupt, so an interrupt-driven paint would take more CPU time than
+// these loops. The spare cycles in the loops are used instead (clearing,
+// ABG_OVERLAY). ABG_BANDS overlaps rendering with the panel scan.
+
+#if defined(ABG_OVERLAY)
+// Composite segs pages of w plus-mask overlay bytes into the buffer,
+// backwards from buf and ovl, which point past the last byte of each.
+// progmem: ovl is in flash
+inline void overlay_composite(uint8_t* buf, uint8_t const* ovl, uint8_t w, uint8_t segs,
+    bool progmem)
+{
+    do
+    {
+        uint8_t c = w;
+        do
+        {
+            ovl -= 2;
+            uint8_t m = progmem ? pgm_read_byte(ovl + 1) : ovl[1];
+            uint8_t d = progmem ? pgm_read_byte(ovl + 0) : ovl[0];
+            uint8_t t = *--buf;
+            *buf = (t & ~m) | d;
+        } while(--c != 0);
+        buf -= 128 - w;
+    } while(--segs != 0);
+}
+#endif
+
+#if !defined(ARDUINO_ARCH_AVR)
+
+struct Display_Host
+{
+    // data bytes as they would be sent, after masking, in order since
+    // out_count was last reset; bytes past the end are counted only
+    static uint8_t  out[2048];
+    static uint16_t out_count;
+    
+    static void start() { out_count = 0; }
+    
+    static void send(uint8_t b)
+    {
+        if(out_count < sizeof(out))
+            out[out_count] = b;
+        ++out_count;
+    }
+    
+    static void paint(uint8_t* image, uint16_t clear, uint16_t pages, uint8_t mask)
+    {
+        uint8_t* buf = image + uint16_t(uint8_t(pages)) * 128;
+        for(uint16_t n = uint16_t(uint8_t(pages)) * 128; n != 0; --n)
+        {
+            uint8_t b = *--buf;
+            if(uint8_t(clear) != 0)
+                *buf = uint8_t(clear >> 8);
+            send(b & mask);
+        }
+    }
+    
+#if defined(ABG_CLEAR_PATTERN)
+    static void paintPattern(uint8_t* image, uint8_t const* row, uint16_t pages, uint8_t mask)
+    {
+        for(uint8_t p = uint8_t(pages); p-- != 0;)
+            paint(image + p * 128, (uint16_t(row[p]) << 8) | 1, 1, mask);
+    }
+#endif
+    
+#if defined(ABG_OVERLAY)
+    static void paintOverlay(uint8_t* image, uint16_t clear, uint16_t pages, uint8_t mask,
+        uint8_t const* ovl, uint8_t x, uint8_t w, uint8_t skip, uint8_t segs, bool progmem)
+    {
+        overlay_composite(image + (uint8_t(pages) - skip - 1) * 128 + x + w, ovl, w, segs, progmem);
+        paint(image, clear, pages, mask);
+    }
+#endif
+};
+
+using Display = Display_Host;
+
+#elif defined(OLED_SH1106) || defined(LCD_ST7565)
+
+// D/C is latched at the 8th clock of each byte, so the loops below toggle
+// it while the first byte of the new kind is being sent, and send the
+// page and column commands bit-reversed to keep SPCR DORD set throughout.
+// Each page then costs three back-to-back SPI bytes of overhead.
+static constexpr uint8_t bit_reverse(uint8_t x)
+{
+    return
+        ((x & 0x01) << 7) | ((x & 0x02) << 5) | ((x & 0x04) << 3) | ((x & 0x08) << 1) |
+        ((x & 0x10) >> 1) | ((x & 0x20) >> 3) | ((x & 0x40) >> 5) | ((x & 0x80) >> 7);
+}
+
+struct Display_SH1106
+{
+    // the page is merged into the reversed command with bst/bld
+    static_assert((OLED_SET_PAGE_ADDRESS & 7) == 0,
+        "OLED_SET_PAGE_ADDRESS must leave the low 3 bits for the page");
+    
+    static void start()
+    {
+        // clock divider (not set in homemade package)
+        send_cmds_prog<0xD5, 0xF0>();
+    }
+    
+    __attribute__((naked, noinline))
+    static void paint(uint8_t* image, uint16_t clear, uint16_t pages, uint8_t mask)
+    {
+        // image: r24:r25
+        // clear: r22:r23
+        // pages: r20:r21
+        // mask : r18
+        asm volatile(
+        
+            R"ASM(
+                 
+                ; set SPCR DORD to MSB-to-LSB order
+                ldi  r19, %[DORD1]
+                out  %[spcr], r19
+                
+                ; set buffer pointer to end of buffer pages
+                movw r26, r24
+                ldi  r19, 128
+                mul  r20, r19
+                movw r24, r0
+                clr  __zero_reg__
+                add  r26, r24
+                adc  r27, r25
+                rjmp 1f
+                
+            5:  inc  r21
+                dec  r20
+                breq 8f
+                
+                ; outer loop: page command, 18 cycles after the last data byte
+            1:  ldi  r25, %[page_cmd]
+                bst  r21, 0
+                bld  r25, 7
+                bst  r21, 1
+                bld  r25, 6
+                bst  r21, 2
+                bld  r25, 5
+                rjmp .+0
+                nop
+                out  %[spdr], r25 ; set page
+                ldi  r19, %[col_cmd]
+                cbi  %[dc_port], %[dc_bit]
+                ldi  r24, 128
+                rcall 3f
+                rjmp .+0
+                rjmp .+0
+                rjmp .+0
+                out  %[spdr], r19 ; set column hi
+                
+                ; first byte of the page, switching D/C back to data
+                ld   __tmp_reg__, -X
+                mov  r19, __tmp_reg__
+                cpse r22, __zero_reg__
+                mov  r19, r23
+                st   X, r19
+                and  __tmp_reg__, r18
+                rcall 3f
+                rjmp .+0
+                out  %[spdr], __tmp_reg__
+                sbi  %[dc_port], %[dc_bit]
+                dec  r24
+           
+                ; main loop: send buffer in reverse direction, masking bytes
+            2:  ld   __tmp_reg__, -X
+                mov  r19, __tmp_reg__
+                cpse r22, __zero_reg__
+                mov  r19, r23
+                st   X, r19
+                lpm  r19, Z
+                lpm  r19, Z
+                and  __tmp_reg__, r18
+                out  %[spdr], __tmp_reg__
+                dec  r24
+                brne 2b
+                rjmp 5b
+                                
+                ; delay for final byte, then reset SPCR DORD and clear SPIF
+            8:  rcall 3f
+                rcall 3f
+                ldi  r19, %[DORD2]
+                in   __tmp_reg__, %[spsr]
+                out  %[spcr], r19
+            3:  ret
+            
+            )ASM"
+            
+            :
+            : [spdr]     "I"   (_SFR_IO_ADDR(SPDR)),
+              [spsr]     "I"   (_SFR_IO_ADDR(SPSR)),
+              [spcr]     "I"   (_SFR_IO_ADDR(SPCR)),
+              [page_cmd] "M"   (bit_reverse(OLED_SET_PAGE_ADDRESS)),
+              [col_cmd]  "M"   (bit_reverse(OLED_SET_COLUMN_ADDRESS_HI)),
+              [DORD1]    "i"   (_BV(SPE) | _BV(MSTR) | _BV(DORD)),
+              [DORD2]    "i"   (_BV(SPE) | _BV(MSTR)),
+              [dc_port]  "I"   (_SFR_IO_ADDR(DC_PORT)),
+              [dc_bit]   "I"   (DC_BIT)
+            );
+    }
+    
+#if defined(ABG_CLEAR_PATTERN)
+    __attribute__((naked, noinline))
+    static void paintPattern(uint8_t* image, uint8_t const* row, uint16_t pages, uint8_t mask)
+    {
+        // image: r24:r25
+        // row  : r22:r23
+        // pages: r20:r21
+        // mask : r18
+        asm volatile(
+        
+            R"ASM(
+                 
+                ; set SPCR DORD to MSB-to-LSB order
+                ldi  r19, %[DORD1]
+                out  %[spcr], r19
+                
+                ; set buffer pointer to end of buffer pages
+                movw r26, r24
+                ldi  r19, 128
+                mul  r20, r19
+                movw r24, r0
+                clr  __zero_reg__
+                add  r26, r24
+                adc  r27, r25
+                
+                ; set row pointer to end of page bytes
+                movw r30, r22
+                add  r30, r20
+                adc  r31, __zero_reg__
+                rjmp 1f
+                
+            5:  inc  r21
+                dec  r20
+                breq 8f
+                
+                ; outer loop: page command, 18 cycles after the last data byte
+            1:  ldi  r25, %[page_cmd]
+                bst  r21, 0
+                bld  r25, 7
+                bst  r21, 1
+                bld  r25, 6
+                bst  r21, 2
+                bld  r25, 5
+                rjmp .+0
+                nop
+                out  %[spdr], r25 ; set page
+                ldi  r19, %[col_cmd]
+                cbi  %[dc_port], %[dc_bit]
+                ldi  r24, 128
+                ld   r23, -Z
+                rcall 3f
+                rjmp .+0
+                rjmp .+0
+                out  %[spdr], r19 ; set column hi
+                
+                ; first byte of the page, switching D/C back to data
+                ld   __tmp_reg__, -X
+                st   X, r23
+                and  __tmp_reg__, r18
+                rcall 3f
+                rjmp .+0
+                rjmp .+0
+                nop
+                out  %[spdr], __tmp_reg__
+                sbi  %[dc_port], %[dc_bit]
+                dec  r24
+           
+                ; main loop: send buffer in reverse direction, masking bytes
+            2:  ld   __tmp_reg__, -X
+                st   X, r23
+                rcall 3f
+                rjmp .+0
+                and  __tmp_reg__, r18
+                out  %[spdr], __tmp_reg__
+                dec  r24
+                brne 2b
+                rjmp 5b
+                                
+                ; delay for final byte, then reset SPCR DORD and clear SPIF
+            8:  rcall 3f
+                rcall 3f
+                ldi  r19, %[DORD2]
+                in   __tmp_reg__, %[spsr]
+                out  %[spcr], r19
+            3:  ret
+            
+            )ASM"
+            
+            :
+            : [spdr]     "I"   (_SFR_IO_ADDR(SPDR)),
+              [spsr]     "I"   (_SFR_IO_ADDR(SPSR)),
+              [spcr]     "I"   (_SFR_IO_ADDR(SPCR)),
+              [page_cmd] "M"   (bit_reverse(OLED_SET_PAGE_ADDRESS)),
+              [col_cmd]  "M"   (bit_reverse(OLED_SET_COLUMN_ADDRESS_HI)),
+              [DORD1]    "i"   (_BV(SPE) | _BV(MSTR) | _BV(DORD)),
+              [DORD2]    "i"   (_BV(SPE) | _BV(MSTR)),
+              [dc_port]  "I"   (_SFR_IO_ADDR(DC_PORT)),
+              [dc_bit]   "I"   (DC_BIT)
+            );
+    }
+#endif
+    
+#if defined(ABG_OVERLAY)
+    // no free pointer in the paint loop, so composite into the buffer
+    static void paintOverlay(uint8_t* image, uint16_t clear, uint16_t pages, uint8_t mask,
+        uint8_t const* ovl, uint8_t x, uint8_t w, uint8_t skip, uint8_t segs, bool progmem)
+    {
+        overlay_composite(image + (uint8_t(pages) - skip - 1) * 128 + x + w, ovl, w, segs, progmem);
+        paint(image, clear, pages, mask);
+    }
+#endif
+};
+
+// same page addressing as SH1106, without its clock divider setting
+struct Display_ST7565 : Display_SH1106
+{
+    static void start() {}
+};
+
+#if defined(OLED_SH1106)
+using Display = Display_SH1106;
+#else
+using Display = Display_ST7565;
+#endif
+
+#else
+
+struct Display_SSD1306
+{
+    static void start()
+    {
+#if defined(ABG_VIEWPORT_PAGES)
+        // wrap GDDRAM writes after the viewport pages
+        send_cmds_prog<0x22, 0, ABG_VIEWPORT_PAGES - 1>();
+#endif
+    }
+    
+    __attribute__((naked, noinline))
+    static void paint(uint8_t* image, uint16_t clear, uint16_t pages, uint8_t mask)
+    {
+        // image: r24:r25
+        // clear: r22:r23
+        // pages: r20:r21
+        // mask : r18
+        asm volatile(
+        
+            R"ASM(
+        
+                ; set SPCR DORD to MSB-to-LSB order
+                ldi  r19, %[DORD1]
+                out  %[spcr], r19
+                
+                ; init counter and set buffer pointer to end of buffer pages
+                movw r26, r24
+                ldi  r19, 128
+                mul  r20, r19
+                movw r24, r0
+                clr  __zero_reg__
+                add  r26, r24
+                adc  r27, r25
+        
+                ; main loop: send buffer in reverse direction, masking bytes
+            1:  ld   r21, -X
+                mov  r19, r21
+                cpse r22, __zero_reg__
+                mov  r19, r23
+                st   X, r19
+                lpm
+                rjmp .+0
+                and  r21, r18
+                out  %[spdr], r21
+                sbiw r24, 1
+                brne 1b
+                
+                ; delay for final byte, then reset SPCR DORD and clear SPIF
+                rcall 2f
+                rcall 2f
+                ldi  r19, %[DORD2]
+                in   __tmp_reg__, %[spsr]
+                out  %[spcr], r19
+            2:  ret
+        
+            )ASM"
+            
+            :
+            : [spdr]    "I"   (_SFR_IO_ADDR(SPDR)),
+              [spsr]    "I"   (_SFR_IO_ADDR(SPSR)),
+              [spcr]    "I"   (_SFR_IO_ADDR(SPCR)),
+              [DORD1]   "i"   (_BV(SPE) | _BV(MSTR) | _BV(DORD)),
+              [DORD2]   "i"   (_BV(SPE) | _BV(MSTR))
+            );
+    }
+    
+#if defined(ABG_CLEAR_PATTERN)
+    __attribute__((naked, noinline))
+    static void paintPattern(uint8_t* image, uint8_t const* row, uint16_t pages, uint8_t mask)
+    {
+        // image: r24:r25
+        // row  : r22:r23
+        // pages: r20:r21
+        // mask : r18
+        asm volatile(
+        
+            R"ASM(
+        
+                ; set SPCR DORD to MSB-to-LSB order
+                ldi  r19, %[DORD1]
+                out  %[spcr], r19
+                
+                ; set buffer pointer to end of buffer pages
+                movw r26, r24
+                ldi  r19, 128
+                mul  r20, r19
+                movw r24, r0
+                clr  __zero_reg__
+                add  r26, r24
+                adc  r27, r25
+                
+                ; set row pointer to end of page bytes
+                movw r30, r22
+                add  r30, r20
+                adc  r31, __zero_reg__
+        
+                ; outer loop: fetch the clear byte for the next page
+            1:  ld   r23, -Z
+                ldi  r24, 128
+                
+                ; main loop: send buffer in reverse direction, masking bytes
+            2:  ld   r21, -X
+                st   X, r23
+                rcall 3f
+                rjmp .+0
+                and  r21, r18
+                out  %[spdr], r21
+                dec  r24
+                brne 2b
+                dec  r20
+                brne 1b
+                
+                ; delay for final byte, then reset SPCR DORD and clear SPIF
+                rcall 3f
+                rcall 3f
+                ldi  r19, %[DORD2]
+                in   __tmp_reg__, %[spsr]
+                out  %[spcr], r19
+            3:  ret
+        
+            )ASM"
+            
+            :
+            : [spdr]    "I"   (_SFR_IO_ADDR(SPDR)),
+              [spsr]    "I"   (_SFR_IO_ADDR(SPSR)),
+              [spcr]    "I"   (_SFR_IO_ADDR(SPCR)),
+              [DORD1]   "i"   (_BV(SPE) | _BV(MSTR) | _BV(DORD)),
+              [DORD2]   "i"   (_BV(SPE) | _BV(MSTR))
+            );
+    }
+#endif
     
-    Default = L3,
-};
-
-struct ABG_Flags
-{
-    enum
+#if defined(ABG_OVERLAY)
+    // paint() that also composites segs pages of w overlay bytes at
+    // column x, skipping the first skip pages sent; ovl points past the
+    // last (data, mask) pair to send, in flash if progmem
+    __attribute__((noinline))
+    static void paintOverlay(uint8_t* image, uint16_t clear, uint16_t pages, uint8_t mask,
+        uint8_t const* ovl, uint8_t x, uint8_t w, uint8_t skip, uint8_t segs, bool progmem)
     {
-        None = 0,
+        uint8_t n = uint8_t(pages);
+        uint8_t* buf = image + uint16_t(n) * 128;
+        uint16_t count = uint16_t(n) * 128;
+        // bytes sent before the first overlay byte, plus one
+        uint16_t cd = uint16_t(skip) * 128 + (129 - x - w);
+        uint8_t gap = 129 - w;
+        uint8_t b, t, left;
+        asm volatile(
         
-        Default =
-            0,
-    };
-};
-
-#ifdef __GNUC__
-#define ABG_NOT_SUPPORTED __attribute__((error( \
-    "This method cannot be called when using ArduboyG.")))
-#else
-// will still cause linker error
-#define ABG_NOT_SUPPORTED
-#endif
-
-namespace abg_detail
-{
-
-static constexpr uint8_t num_planes(ABG_Mode mode)
-{
-    return
-        mode == ABG_Mode::L4_Contrast ? 2 :
-        mode == ABG_Mode::L4_Triplane ? 3 :
-        mode == ABG_Mode::L3          ? 2 :
-        1;
-}
-
-#if defined(ABG_TIMER3) || defined(ABG_TIMER1)
-constexpr uint16_t timer_counter = F_CPU / 64 / ABG_REFRESH_HZ;
-#elif defined(ABG_TIMER4)
-constexpr uint16_t timer_counter = F_CPU / 256 / ABG_REFRESH_HZ;
-#endif
-extern uint8_t  contrast;
-extern uint8_t  plane_contrast_L4[3];
-extern uint8_t  plane_contrast_L3[2];
-extern uint8_t  update_counter;
-extern uint8_t  update_every_n;
-extern uint8_t  update_every_n_denom;
-extern uint8_t  current_plane;
-#if defined(ABG_SYNC_THREE_PHASE)
-extern uint8_t volatile current_phase;
+            R"ASM(
+            
+                ; set SPCR DORD to MSB-to-LSB order
+                ldi  %[t], %[DORD1]
+                out  %[spcr], %[t]
+                
+                ; main loop: as in paint(), counting down to the overlay
+            1:  ld   %[b], -%a[buf]
+                mov  %[t], %[b]
+                cpse %A[clear], __zero_reg__
+                mov  %[t], %B[clear]
+                st   %a[buf], %[t]
+                subi %A[cd], 1
+                sbci %B[cd], 0
+                breq 3f
+                rjmp .+0
+                and  %[b], %[mask]
+                out  %[spdr], %[b]
+                sbiw %A[count], 1
+                brne 1b
+                rjmp 6f
+                
+                ; overlay loop: composite w bytes, reading mask then data
+            3:  mov  %[left], %[w]
+                cpse %[progmem], __zero_reg__
+                rjmp 8f
+            4:  ld   %[t], -%a[ovl]
+                com  %[t]
+                and  %[b], %[t]
+                ld   %[t], -%a[ovl]
+                or   %[b], %[t]
+                and  %[b], %[mask]
+                out  %[spdr], %[b]
+                sbiw %A[count], 1
+                breq 6f
+                dec  %[left]
+                breq 5f
+                ld   %[b], -%a[buf]
+                mov  %[t], %[b]
+                cpse %A[clear], __zero_reg__
+                mov  %[t], %B[clear]
+                st   %a[buf], %[t]
+                rjmp 4b
+                
+                ; count down to the next page of the overlay, if any
+            5:  ldi  %A[cd], 0
+                ldi  %B[cd], 0
+                dec  %[segs]
+                breq 1b
+                mov  %A[cd], %[gap]
+                rjmp 1b
+                
+                ; as the overlay loop, reading flash: lpm has no predecrement,
+                ; so each byte costs 6 more cycles
+            8:  sbiw %A[ovl], 1
+                lpm  %[t], %a[ovl]
+                com  %[t]
+                and  %[b], %[t]
+                sbiw %A[ovl], 1
+                lpm  %[t], %a[ovl]
+                or   %[b], %[t]
+                and  %[b], %[mask]
+                out  %[spdr], %[b]
+                sbiw %A[count], 1
+                breq 6f
+                dec  %[left]
+                breq 5b
+                ld   %[b], -%a[buf]
+                mov  %[t], %[b]
+                cpse %A[clear], __zero_reg__
+                mov  %[t], %B[clear]
+                st   %a[buf], %[t]
+                rjmp 8b
+                
+                ; delay for final byte, then reset SPCR DORD and clear SPIF
+            6:  ldi  %[t], 5
+            7:  dec  %[t]
+                brne 7b
+                ldi  %[t], %[DORD2]
+                in   __tmp_reg__, %[spsr]
+                out  %[spcr], %[t]
+            
+            )ASM"
+            
+            : [buf]   "+&e" (buf),
+              [ovl]   "+&z" (ovl),
+              [count] "+&w" (count),
+              [cd]    "+&d" (cd),
+              [segs]  "+&r" (segs),
+              [b]     "=&r" (b),
+              [t]     "=&d" (t),
+              [left]  "=&r" (left)
+            : [w]     "r"   (w),
+              [gap]   "r"   (gap),
+              [mask]  "r"   (mask),
+              [clear] "r"   (clear),
+              [progmem] "r" (progmem),
+              [spdr]  "I"   (_SFR_IO_ADDR(SPDR)),
+              [spsr]  "I"   (_SFR_IO_ADDR(SPSR)),
+              [spcr]  "I"   (_SFR_IO_ADDR(SPCR)),
+              [DORD1] "i"   (_BV(SPE) | _BV(MSTR) | _BV(DORD)),
+              [DORD2] "i"   (_BV(SPE) | _BV(MSTR))
+            : "memory"
+            );
+    }
 #endif
-extern bool volatile needs_display;
-
-template<class T>
-inline uint8_t pgm_read_byte_inc(T const*& p)
-{
-    uint8_t r;
-    asm volatile("lpm %[r], %a[p]+\n" : [p] "+&z" (p), [r] "=&r" (r));
-    return r;
-}
-template<class T>
-inline uint8_t deref_inc(T const*& p)
-{
-    uint8_t r;
-    asm volatile("ld %[r], %a[p]+\n" : [p] "+&e" (p), [r] "=&r" (r) :: "memory");
-    return r;
-}
-
-void send_cmds_(uint8_t const* d, uint8_t n);
-void send_cmds_prog_(uint8_t const* d, uint8_t n);
-
-template<uint8_t... CMDS> void send_cmds_prog()
-{
-    static uint8_t const CMDS_[] PROGMEM = { CMDS... };
-    send_cmds_prog_(CMDS_, sizeof(CMDS_));
-}
-
-inline void send_cmds_helper() {}
+};
 
-template<class... CMDS>
-inline void send_cmds_helper(uint8_t first, CMDS... rest)
-{
-    Arduboy2Base::SPItransfer(first);
-    send_cmds_helper(rest...);
-}
+using Display = Display_SSD1306;
 
-template<class... CMDS> inline void send_cmds(CMDS... cmds)
-{
-#if 1
-    uint8_t const CMDS_[] = { cmds... };
-    send_cmds_(CMDS_, sizeof(CMDS_));
-#else
-    Arduboy2Base::LCDCommandMode();
-    send_cmds_helper(cmds...);
-    Arduboy2Base::LCDDataMode();
 #endif
-}
 
 template<
     class    BASE,
@@ -299,40 +1469,61 @@ template<
 struct ArduboyG_Common : public BASE
 {
     
+#if !defined(ABG_SYNC_PARK_ROW)
+    static_assert(MODE != ABG_Mode::L8_Binary,
+        "ABG_Mode::L8_Binary requires ABG_SYNC_PARK_ROW");
+#endif
+#if defined(ABG_BANDS)
+    static_assert(MODE != ABG_Mode::L8_Binary,
+        "ABG_Mode::L8_Binary cannot be used with ABG_BANDS");
+    
+    static uint8_t* getBuffer() { return band_buffer; }
+    static uint8_t bandY() { return band_y; }
+#endif
+    
     static void startGray()
     {
+        // ABG_UPDATE_HZ_DEFAULT depends on the refresh periods per frame
+        if(update_hz != 0)
+            setUpdateHz(update_hz);
+        
+        Display::start();
         send_cmds_prog<
             0xC0, 0xA0, // reset to normal orientation
             0xD9, ((ABG_PRECHARGE_CYCLES) | ((ABG_DISCHARGE_CYCLES) << 4)),
-#if defined(OLED_SH1106)
-            0xD5, 0xF0, // clock divider (not set in homemade package)
-#endif
 #if defined(ABG_SYNC_PARK_ROW) || defined(ABG_SYNC_SLOW_DRIVE)
             0x81, 255,  // default contrast
 #endif
             0xA8, 0     // park at row 0
         >();
 
+        uint16_t top = timer_counter;
+#if defined(ABG_SYNC_PARK_ROW)
+        binary_planes = MODE == ABG_Mode::L8_Binary;
+        if(binary_planes)
+            top = binary_top(0);
+#endif
+        
         uint8_t sreg = SREG;
         cli();
 #if defined(ABG_TIMER3)
         // Fast PWM mode, prescaler /64
-        OCR3A = timer_counter;
+        OCR3A = top;
         TCCR3A = _BV(WGM31) | _BV(WGM30);
         TCCR3B = _BV(WGM33) | _BV(WGM32) | _BV(CS31) | _BV(CS30);
         TCNT3 = 0;
         bitWrite(TIMSK3, OCIE3A, 1);
 #elif defined(ABG_TIMER1)
         // Fast PWM mode, prescaler /64
-        OCR1A = timer_counter;
+        OCR1A = top;
         TCCR1A = _BV(WGM11) | _BV(WGM10);
         TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS11) | _BV(CS10);
         TCNT1 = 0;
         bitWrite(TIMSK1, OCIE1A, 1);
 #elif defined(ABG_TIMER4)
         // Fast PWM mode, prescaler /256
-        TC4H = (timer_counter >> 8);
-        OCR4C = timer_counter;
+        TC4H = (top >> 8);
+        OCR4C = top;
         TCCR4A = 0;
         TCCR4B = 0x09; // prescaler /256
         TCCR4C = 0x01; // PWM4D=1 just to enable fast PWM
@@ -350,12 +1541,35 @@ struct ArduboyG_Common : public BASE
     static void setContrast(uint8_t f)
     {
         // have compiler optimize out assignment if it's not needed
-        if(MODE == ABG_Mode::L4_Contrast)
+        if(MODE == ABG_Mode::L4_Contrast || MODE == ABG_Mode::Runtime)
             contrast = f;
     }
     
+    // use this method to switch modes when using ABG_Mode::Runtime
+    static void setMode(ABG_Mode m, ABG_Convert convert = ABG_Convert::None)
+    {
+        if(MODE != ABG_Mode::Runtime || m == ABG_Mode::L8_Binary)
+            return;
+        uint8_t sreg = SREG;
+        cli();
+        requested_mode = m;
+        requested_convert = m == ABG_Mode::L4_Triplane ? convert : ABG_Convert::None;
+        SREG = sreg;
+    }
+    
+    // the mode currently displayed
+    static ABG_Mode mode()
+    {
+        return MODE == ABG_Mode::Runtime ? runtime_mode : MODE;
+    }
+    
     static void setUpdateEveryN(uint8_t num, uint8_t denom = 1)
     {
+        update_hz = 0;
+#if defined(ABG_GOVERNOR)
+        governor_update_every_n = num;
+        num = governorUpdateEveryN();
+#endif
         update_every_n = num;
         update_every_n_denom = denom;
         if(update_counter >= num)
@@ -363,10 +1577,74 @@ struct ArduboyG_Common : public BASE
     }
     
     static void setUpdateHz(uint8_t hz)
+    {
+        if(hz > refresh_hz) hz = refresh_hz;
+        uint16_t n = refresh_hz / updatePlanes();
+        uint8_t d = hz;
+        // keep the ratio when the frame rate does not fit update_every_n
+        while(n > 255)
+        {
+            n >>= 1;
+            d = (d + 1) >> 1;
+        }
+        setUpdateEveryN(uint8_t(n), d);
+        update_hz = hz;
+    }
+    
+#if defined(ABG_RUNTIME_REFRESH)
+    // Trade refresh rate for render time per plane. ABG_REFRESH_HZ is the
+    // upper limit, as it must stay below the display's own frame rate.
+    // The update rate set by setUpdateHz() is kept.
+    static void setRefreshHz(uint16_t hz)
     {
         if(hz > ABG_REFRESH_HZ) hz = ABG_REFRESH_HZ;
-        setUpdateEveryN(ABG_REFRESH_HZ / num_planes(MODE), hz);
+        if(hz < refresh_hz_min) hz = refresh_hz_min;
+        uint16_t tc = timer_counter_for(hz);
+        uint8_t sreg = SREG;
+        cli();
+        // The frame ISR programs the timer from timer_counter, and TOP is
+        // double buffered, so the new rate starts on a period boundary.
+        timer_counter = tc;
+        SREG = sreg;
+        refresh_hz = hz;
+        if(update_hz != 0)
+            setUpdateHz(update_hz);
+    }
+    
+#endif
+    
+    static uint16_t refreshHz() { return refresh_hz; }
+    
+#if defined(ABG_OVERLAY)
+    // data holds a frame of w columns by pages pages for each plane, in
+    // the SpritesU plus-mask layout (data and mask bytes interleaved), and
+    // is placed at column x and page page. The frame for currentPlane()
+    // is used. data is read as each plane is sent, so data in RAM can be
+    // changed at any time; with progmem, data is a PROGMEM table and
+    // costs no RAM. x + w must not exceed 128.
+    static void setOverlay(uint8_t const* data,
+        uint8_t x, uint8_t page, uint8_t w, uint8_t pages, bool progmem = false)
+    {
+        uint8_t sreg = SREG;
+        cli();
+        overlay_data    = data;
+        overlay_x       = x;
+        overlay_page    = page;
+        overlay_w       = w;
+        overlay_pages   = pages;
+        overlay_progmem = progmem;
+        SREG = sreg;
     }
+    
+    static void clearOverlay() { overlay_w = 0; }
+#endif
+    
+#if defined(ABG_CLEAR_PATTERN)
+    // pattern holds 8 bytes per plane (one for each buffer page, top page
+    // first) and replaces the clear color passed to waitForNextPlane()
+    // until it is reset with nullptr. It is read as each plane is sent.
+    static void setClearPattern(uint8_t const* pattern) { clear_pattern = pattern; }
+#endif
 
     static void drawBitmap(
         int16_t x, int16_t y,
@@ -648,8 +1926,17 @@ struct ArduboyG_Common : public BASE
 
     static uint8_t currentPlane()
     {
-        if(MODE == ABG_Mode::L4_Triplane)
+        if(mode() == ABG_Mode::L4_Triplane)
         {
+            if(dynamicPlanes())
+            {
+                ABG_Convert c = plane_convert;
+                if(c == ABG_Convert::Mix)
+                    return current_plane << 1;
+                if(c == ABG_Convert::Darken)
+                    return current_plane + 1;
+                return current_plane;
+            }
 #if defined(ABG_L3_CONVERT_LIGHTEN)
             return current_plane;
 #elif defined(ABG_L3_CONVERT_MIX)
@@ -673,11 +1960,38 @@ struct ArduboyG_Common : public BASE
     
     static void waitForNextPlane(uint8_t clear = BLACK)
     {
+#if defined(ABG_BANDS)
+        if(band_y != 0)
+        {
+            paintBottomBand(clear);
+            return;
+        }
+#endif
+#if defined(ABG_GOVERNOR)
+        governor();
+#endif
+#if defined(ABG_PROFILE)
+        uint16_t render = profile_now() - profile_display_end;
+        uint16_t idle = 0;
+#endif
         do
         {
+#if defined(ABG_PROFILE)
+            uint16_t sleep_start = profile_now();
+#endif
             cli();
             for(;;)
             {
+#if defined(ABG_SYNC_PARK_ROW)
+                if(MODE == ABG_Mode::L8_Binary && binary_park_pending)
+                {
+                    // the park ISR leaves SPI to the main loop
+                    binary_park_pending = false;
+                    sei();
+                    send_cmds_prog<0xA8, 0>();
+                    cli();
+                }
+#endif
                 if(needs_display)
                     break;
                 sleep_enable();
@@ -687,15 +2001,89 @@ struct ArduboyG_Common : public BASE
                 cli();
             }
             needs_display = false;
+#if defined(ABG_PROFILE)
+            uint8_t isrs = profile_isrs;
+            profile_isrs = 0;
+#endif
             sei();
+#if defined(ABG_TRACE)
+            trace_(trace_wake, 0);
+#endif
+#if defined(ABG_PROFILE)
+            idle += profile_now() - sleep_start;
+            if(isrs > 1)
+                profile_stats.missed += isrs - 1;
+#endif
+#if defined(ABG_EVENTS)
+            drainEvents();
+#endif
+#if defined(ABG_TRACE)
+            trace_(trace_display, current_plane);
             doDisplay(clear);
+            trace_(trace_display | trace_end, current_plane);
+#else
+            doDisplay(clear);
+#endif
         }
 #if defined(ABG_SYNC_THREE_PHASE)
         while(current_phase != 3);
 #elif defined(ABG_SYNC_PARK_ROW) || defined(ABG_SYNC_SLOW_DRIVE)
         while(0);
 #endif
+#if defined(ABG_PROFILE)
+        uint16_t now = profile_now();
+        profile_plane_(render, idle, now - profile_display_end);
+        profile_display_end = now;
+#endif
+    }
+    
+#if defined(ABG_PROFILE)
+    static ABG_Profile const& getProfile() { return profile_stats; }
+#endif
+    
+#if defined(ABG_EVENTS)
+    static ABG_EventStats const& eventStats() { return event_stats; }
+    
+    // handler is called from waitForNextPlane() for each drained event
+    static void setEventHandler(void (*handler)(ABG_Event const&)) { event_handler = handler; }
+#endif
+    
+#if defined(ABG_TRACE)
+    // mark a user span, such as update() or render(), with an id of the
+    // caller's choosing
+    static void traceBegin(uint8_t id) { trace_(trace_user, id); }
+    static void traceEnd(uint8_t id) { trace_(trace_user | trace_end, id); }
+    
+    // Print the trace ring oldest first for bench/abg_trace.py, one entry
+    // per line as "time kind arg". Recording is paused while printing.
+    static void traceDump(Print& out)
+    {
+        trace_paused = true;
+        out.print(F("ABG_TRACE "));
+        out.println(timer_tick_us);
+        uint8_t i = trace_index;
+        do
+        {
+            trace_entry const& e = trace_ring[i];
+            if(e.kind != 0)
+            {
+                out.print(e.time);
+                out.print(' ');
+                out.print(e.kind);
+                out.print(' ');
+                out.println(e.arg);
+            }
+            i = (i + 1) & trace_mask;
+        } while(i != trace_index);
+        out.println(F("ABG_TRACE_END"));
+        trace_paused = false;
     }
+#endif
+    
+#if defined(ABG_GOVERNOR)
+    // 0: full rate, 1: update rate lowered, 2: L4_Triplane shown as L3
+    static uint8_t governorLevel() { return governor_level; }
+#endif
         
     ABG_NOT_SUPPORTED static void flipVertical();
     ABG_NOT_SUPPORTED static void paint8Pixels(uint8_t);
@@ -721,21 +2109,208 @@ struct ArduboyG_Common : public BASE
     static void bootPins       () { BASE::bootPins       (); }
     static void bootPowerSaving() { BASE::bootPowerSaving(); }
     
-    // color conversion method
-    static uint8_t color (uint8_t c) { return planeColor(current_plane, c); }
-    static uint8_t colour(uint8_t c) { return planeColor(current_plane, c); }
+    // color conversion method
+    static uint8_t color (uint8_t c) { return planeColor(current_plane, c); }
+    static uint8_t colour(uint8_t c) { return planeColor(current_plane, c); }
+    
+protected:
+    
+#if defined(ABG_GOVERNOR)
+    static uint8_t governorMaxLevel()
+    {
+        return (mode() == ABG_Mode::L4_Triplane && requested_convert == ABG_Convert::None) ? 2 : 1;
+    }
+    
+    // Two-plane frames come 3/2 times as often as three-plane frames, so
+    // level 2 scales update_every_n by 3 to keep the update rate of level 1
+    // when updates are counted per frame.
+    static uint8_t governorUpdateEveryN()
+    {
+        uint16_t n = governor_update_every_n;
+        if(governor_level == 1) n *= 2;
+        if(governor_level == 2) n *= 3;
+        return n > 255 ? 255 : uint8_t(n);
+    }
+    
+    static void governor()
+    {
+        uint8_t sreg = SREG;
+        cli();
+        bool overrun = needs_display;
+        uint16_t t = timer_count();
+        SREG = sreg;
+        
+        uint8_t level = governor_level;
+        if(overrun)
+        {
+            governor_headroom = 0;
+            if(governor_hold == 0 && level < governorMaxLevel())
+            {
+                ++level;
+                governor_hold = ABG_GOVERNOR_HOLD;
+            }
+        }
+        else if(t < timer_counter - (timer_counter >> 2))
+        {
+            if(++governor_headroom >= ABG_GOVERNOR_RESTORE)
+            {
+                governor_headroom = 0;
+                if(level > 0) --level;
+            }
+        }
+        else
+            governor_headroom = 0;
+        if(governor_hold != 0)
+            --governor_hold;
+        
+        if(level == governor_level)
+            return;
+        governor_level = level;
+        update_every_n = governorUpdateEveryN();
+    }
+#endif
+    
+#if defined(ABG_EVENTS)
+    static void drainEvents()
+    {
+        uint8_t t = event_tail;
+        uint8_t h = event_head;
+        // entries are read only after the head that published them
+        asm volatile("" ::: "memory");
+        uint8_t displays = 0;
+        while(t != h)
+        {
+            ABG_Event e = event_ring[t];
+            t = (t + 1) & event_mask;
+            event_stats.dropped += uint8_t(e.seq - event_next_seq);
+            event_next_seq = e.seq + 1;
+            if(e.latency > event_stats.latency_max)
+                event_stats.latency_max = e.latency;
+            if(e.id & ABG_EVENT_DISPLAY)
+                ++displays;
+            if(event_handler != nullptr)
+                event_handler(e);
+        }
+        // and released only after they have been read
+        asm volatile("" ::: "memory");
+        event_tail = t;
+        if(displays > 1)
+            event_stats.skipped += displays - 1;
+    }
+#endif
+    
+    // whether the plane sequence can change at runtime
+    static constexpr bool dynamicPlanes()
+    {
+#if defined(ABG_GOVERNOR)
+        return true;
+#else
+        return MODE == ABG_Mode::Runtime;
+#endif
+    }
+    
+    static uint8_t planeLimit()
+    {
+        return dynamicPlanes() ? plane_limit : ABG_L4_TRIPLANE_PLANE_LIMIT;
+    }
+    
+    static uint8_t numPlanes()
+    {
+        if(MODE != ABG_Mode::Runtime)
+            return num_planes(MODE);
+        return runtime_mode == ABG_Mode::L4_Triplane ? plane_limit : 2;
+    }
+    
+    // refresh periods per frame for setUpdateHz(); an L3 conversion of
+    // L4_Triplane is not counted, as with the fixed modes
+    static uint8_t updatePlanes()
+    {
+        if(MODE == ABG_Mode::Runtime)
+            return num_planes(runtime_mode);
+        return frame_periods(MODE);
+    }
+    
+    // called by doDisplay when current_plane wraps around to 0
+    static void startFrame()
+    {
+        if(MODE == ABG_Mode::Runtime)
+        {
+            ABG_Mode m = requested_mode;
+#if !defined(ABG_PLANE_CONTRAST)
+            // L4_Contrast leaves the contrast at a per-plane value
+            if(runtime_mode == ABG_Mode::L4_Contrast && m != ABG_Mode::L4_Contrast)
+                send_cmds(0x81, 255);
+#endif
+            bool rescale = num_planes(m) != num_planes(runtime_mode);
+            runtime_mode = m;
+            if(rescale && update_hz != 0)
+                setUpdateHz(update_hz);
+        }
+        if(dynamicPlanes())
+        {
+            ABG_Convert c = requested_convert;
+#if defined(ABG_GOVERNOR)
+            if(governor_level >= 2 && c == ABG_Convert::None)
+                c = ABG_Convert::Mix;
+#endif
+            plane_convert = c;
+            plane_limit = c == ABG_Convert::None ? 3 : 2;
+        }
+        update_counter += update_every_n_denom;
+    }
+    
+#if defined(ABG_BANDS)
+    // The bottom band goes to GDDRAM pages 0-3, which the display has
+    // finished scanning a little after the middle of the period.
+    static void paintBottomBand(uint8_t clear)
+    {
+        uint16_t mid = (timer_counter >> 1) + (timer_counter >> 4);
+        for(;;)
+        {
+            uint8_t sreg = SREG;
+            cli();
+            uint16_t t = timer_count();
+            bool late = needs_display;
+            SREG = sreg;
+            if(late || t >= mid)
+                break;
+        }
+        uint16_t clearcfg = clearConfig(current_plane, clear);
+        paintPages(&band_buffer[128 * 3], 7, clearcfg, 0x0001, 0x7f);
+        paintPages(&band_buffer[128 * 0], 4, clearcfg, 0x0103, 0xff);
+        band_y = 0;
+    }
+#endif
     
-protected:
+    // clear argument of paint() for clearing the buffer for plane
+    static uint16_t clearConfig(uint8_t plane, uint8_t clear)
+    {
+#if defined(ABG_CLEAR_PATTERN)
+        if(clear_pattern != nullptr)
+        {
+            clear_row = clear_pattern + plane * 8;
+            return 2;
+        }
+#endif
+        return planeColor(plane, clear) != 0 ? 0xff01 : 0x0001;
+    }
     
     static void doDisplay(uint8_t clear)
     {
         uint8_t* b = getBuffer();
         
-        uint16_t clearcfg = 1;
+        uint16_t clearcfg;
+#if defined(ABG_SYNC_PARK_ROW)
+        if(MODE == ABG_Mode::L8_Binary)
+        {
+            // follow the ISR schedule if a display ISR was missed
+            current_plane = binary_plane;
+        }
+#endif
         {
             uint8_t p = current_plane;
 #if defined(ABG_PLANE_CONTRAST)
-            if(MODE == ABG_Mode::L3)
+            if(mode() == ABG_Mode::L3)
             {
                 uint8_t contrast = plane_contrast_L3[0];
                 if(p & 1) contrast = plane_contrast_L3[1];
@@ -744,7 +2319,7 @@ protected:
                 Arduboy2Base::SPItransfer(contrast);
                 Arduboy2Base::LCDDataMode();
             }
-            if(MODE == ABG_Mode::L4_Triplane)
+            if(mode() == ABG_Mode::L4_Triplane)
             {
                 uint8_t contrast = plane_contrast_L4[0];
                 if(p & 1) contrast = plane_contrast_L4[1];
@@ -756,50 +2331,73 @@ protected:
             }
 #endif
             p += 1;
-            if(p >= num_planes(MODE)) p = 0;
-            if(planeColor(p, clear) != 0)
-                clearcfg |= 0xff00;
+            if(p >= numPlanes()) p = 0;
+            clearcfg = clearConfig(p, clear);
         }
                 
 #if defined(ABG_SYNC_THREE_PHASE)
         uint8_t phase = current_phase;
         if(phase == 1)
         {
-            if(MODE == ABG_Mode::L4_Contrast)
+            if(mode() == ABG_Mode::L4_Contrast)
                 send_cmds(0x81, (current_plane & 1) ? contrast : contrast / 2);
             send_cmds_prog<0xA8, 7, 0x22, 0, 7>();
         }
         else if(phase == 2)
         {
-            paint(&b[128 * 7], 0, 0x0001, 0xf0);
+            paintPages(&b[128 * 7], 7, 0, 0x0001, 0xf0);
             send_cmds_prog<0x22, 0, 7>();
         }
         else if(phase == 3)
         {
             send_cmds_prog<0x22, 0, 7>();
-            paint(&b[128 * 7], 0, 0x0001, 0xff);
+            paintPages(&b[128 * 7], 7, 0, 0x0001, 0xff);
             send_cmds_prog<0xA8, 0>();
-            paint(&b[128 * 0], clearcfg, 0x0107, 0xff);
-            paint(&b[128 * 7], clearcfg, 0x0001, 0x00);
+            paintPages(&b[128 * 0], 0, clearcfg, 0x0107, 0xff);
+            paintPages(&b[128 * 7], 7, clearcfg, 0x0001, 0x00);
 
-            if(MODE == ABG_Mode::L4_Triplane)
+            if(mode() == ABG_Mode::L4_Triplane)
             {
-                if(++current_plane >= ABG_L4_TRIPLANE_PLANE_LIMIT)
+                if(++current_plane >= planeLimit())
                     current_plane = 0;
             }
             else
                 current_plane = !current_plane;
             if(current_plane == 0)
-                update_counter += update_every_n_denom;
+                startFrame();
         }
 #elif defined(ABG_SYNC_PARK_ROW) || defined(ABG_SYNC_SLOW_DRIVE)
-        if(MODE == ABG_Mode::L4_Contrast)
+        if(mode() == ABG_Mode::L4_Contrast)
             send_cmds(0x81, (current_plane & 1) ? contrast : contrast / 2);
-#if defined(ABG_SYNC_PARK_ROW)
-        paint(&b[128 * 7], clearcfg, 0x0001, 0x7f);
+#if defined(ABG_SYNC_PARK_ROW) && defined(ABG_BANDS)
+        // the bottom band was sent during the previous period
         send_cmds_prog<0xA8, 63>();
-        paint(&b[128 * 0], clearcfg, 0x0107, 0xff);
+        paintPages(&b[128 * 0], 0, clearcfg, 0x0404, 0xff);
         send_cmds_prog<0xA8, 0>();
+        band_y = 32;
+#elif defined(ABG_SYNC_PARK_ROW)
+        paintPages(&b[128 * 7], 7, clearcfg, 0x0001, 0x7f);
+#if defined(ABG_VIEWPORT_PAGES)
+        // GDDRAM pages [0, ABG_VIEWPORT_PAGES) hold the bottom buffer pages
+        send_cmds_prog<0xA8, ABG_VIEWPORT_PAGES * 8 - 1>();
+        paintPages(&b[128 * (8 - ABG_VIEWPORT_PAGES)], 8 - ABG_VIEWPORT_PAGES,
+            clearcfg, 0x0100 + ABG_VIEWPORT_PAGES - 1, 0xff);
+#else
+        send_cmds_prog<0xA8, 63>();
+        paintPages(&b[128 * 0], 0, clearcfg, 0x0107, 0xff);
+#endif
+        if(MODE == ABG_Mode::L8_Binary)
+        {
+            // a park ISR during doDisplay parks after the unpark
+            uint8_t sreg = SREG;
+            cli();
+            if(binary_park_pending)
+                send_cmds_prog<0xA8, 0>();
+            binary_park_pending = false;
+            SREG = sreg;
+        }
+        else
+            send_cmds_prog<0xA8, 0>();
 #elif defined(ABG_SYNC_SLOW_DRIVE)
         {
             uint8_t sreg = SREG;
@@ -809,164 +2407,122 @@ protected:
             // 3. Make phase 1 and 2 very large
             send_cmds_prog<
                 0x22, 0, 7, 0x8D, 0x0, 0xD5, 0x0F, 0xD9, 0xFF>();
-            paint(&b[128 * 7], 0, 0x0001, 0xff);
+            paintPages(&b[128 * 7], 7, 0, 0x0001, 0xff);
             send_cmds_prog<
                 0xA8, 63, 0x8D, 0x14, 0xD9, 0x31, 0xD5, 0xF0>();
             SREG = sreg;
         }
-        paint(&b[128 * 0], clearcfg, 0x0107, 0xff);
+        paintPages(&b[128 * 0], 0, clearcfg, 0x0107, 0xff);
         send_cmds_prog<0xA8, 0>();
-        paint(&b[128 * 7], clearcfg, 0x0001, 0x00);
+        paintPages(&b[128 * 7], 7, clearcfg, 0x0001, 0x00);
 #endif
         uint8_t cp = current_plane;
-        if(MODE == ABG_Mode::L4_Triplane)
+        if(MODE == ABG_Mode::L8_Binary)
+        {
+            if(++cp >= 3)
+                cp = 0;
+        }
+        else if(mode() == ABG_Mode::L4_Triplane)
         {
-            if(++cp >= ABG_L4_TRIPLANE_PLANE_LIMIT)
+            if(++cp >= planeLimit())
                 cp = 0;
         }
         else
             cp = !cp;
-        if(cp == 0)
-            update_counter += update_every_n_denom;
         current_plane = cp;
+        if(cp == 0)
+            startFrame();
 #endif
     }
     
-    // clear: low byte is whether to clear, high byte is clear color
-    // pages: low byte is page count, high byte is starting page (which is unused for SSD1306)
-    __attribute__((naked, noinline))
-    static void paint(uint8_t* image, uint16_t clear, uint16_t pages, uint8_t mask)
+    // Display::paint(), or Display::paintPattern() for a patterned clear
+    // (clear == 2)
+    static void paintClear(uint8_t* image, uint8_t page, uint16_t clear, uint16_t pages, uint8_t mask)
     {
-        // image: r24:r25
-        // clear: r22:r23
-        // pages: r20:r21
-        // mask : r18
-#if defined(OLED_SH1106) || defined(LCD_ST7565)
-        asm volatile(
-        
-            R"ASM(
-                 
-                ; set buffer pointer to end of buffer pages
-                movw r26, r24
-                ldi  r19, 128
-                mul  r20, r19
-                movw r24, r0
-                clr  __zero_reg__
-                add  r26, r24
-                adc  r27, r25
-                
-                ; add OLED_SET_PAGE_ADDRESS
-                subi r21, -(%[page_cmd])
-           
-                ; outer loop
-            1:  ldi  r19, %[DORD2]
-                out  %[spcr], r19
-                cbi  %[dc_port], %[dc_bit]
-                out  %[spdr], r21 ; set page
-                rcall 3f
-                rcall 3f
-                rjmp .+0
-                ldi  r24, %[col_cmd]
-                out  %[spdr], r24 ; set column hi
-                rcall 3f
-                rcall 3f
-                rcall 3f
-                sbi  %[dc_port], %[dc_bit]
-                ldi  r19, %[DORD1]
-                out  %[spcr], r19
-                ldi  r24, 128
-           
-                ; main loop: send buffer in reverse direction, masking bytes
-            2:  ld   __tmp_reg__, -X
-                mov  r19, __tmp_reg__
-                cpse r22, __zero_reg__
-                mov  r19, r23
-                st   X, r19
-                lpm  r19, Z
-                lpm  r19, Z
-                and  __tmp_reg__, r18
-                out  %[spdr], __tmp_reg__
-                dec  r24
-                brne 2b
-                
-                rcall 3f
-                rcall 3f
-                inc  r21
-                dec  r20
-                brne 1b
-                                
-                ; delay for final byte, then reset SPCR DORD and clear SPIF
-                rcall 3f
-                rcall 3f
-                ldi  r19, %[DORD2]
-                in   __tmp_reg__, %[spsr]
-                out  %[spcr], r19
-            3:  ret
-            
-            )ASM"
-            
-            :
-            : [spdr]     "I"   (_SFR_IO_ADDR(SPDR)),
-              [spsr]     "I"   (_SFR_IO_ADDR(SPSR)),
-              [spcr]     "I"   (_SFR_IO_ADDR(SPCR)),
-              [page_cmd] "M"   (OLED_SET_PAGE_ADDRESS),
-              [col_cmd]  "M"   (OLED_SET_COLUMN_ADDRESS_HI),
-              [DORD1]    "i"   (_BV(SPE) | _BV(MSTR) | _BV(DORD)),
-              [DORD2]    "i"   (_BV(SPE) | _BV(MSTR)),
-              [dc_port]  "I"   (_SFR_IO_ADDR(DC_PORT)),
-              [dc_bit]   "I"   (DC_BIT)
-            );
+#if defined(ABG_CLEAR_PATTERN)
+        if(uint8_t(clear) == 2)
+        {
+#if defined(ABG_BANDS)
+            // each band clears the buffer for the other band
+            page ^= 4;
+#endif
+            Display::paintPattern(image, clear_row + page, pages, mask);
+            return;
+        }
 #else
-        asm volatile(
-        
-            R"ASM(
+        (void)page;
+#endif
+        Display::paint(image, clear, pages, mask);
+    }
+    
+#if defined(ABG_OVERLAY)
+    // paint() for buffer pages [page, page + pages), compositing the overlay
+    __attribute__((noinline))
+    static void paintPages_(uint8_t* image, uint8_t page, uint16_t clear, uint16_t pages, uint8_t mask)
+    {
+        uint8_t n  = uint8_t(pages);
+        uint8_t lo = overlay_page;
+        uint8_t hi = overlay_page + overlay_pages;
+        if(lo < page) lo = page;
+        if(hi > page + n) hi = page + n;
+        uint8_t w = overlay_w;
+        if(w == 0 || lo >= hi)
+        {
+            paintClear(image, page, clear, pages, mask);
+            return;
+        }
         
-                ; set SPCR DORD to MSB-to-LSB order
-                ldi  r19, %[DORD1]
-                out  %[spcr], r19
-                
-                ; init counter and set buffer pointer to end of buffer pages
-                movw r26, r24
-                ldi  r19, 128
-                mul  r20, r19
-                movw r24, r0
-                clr  __zero_reg__
-                add  r26, r24
-                adc  r27, r25
+#if defined(ABG_CLEAR_PATTERN)
+        if(uint8_t(clear) == 2)
+        {
+            // one page at a time, so each page gets its clear byte
+            uint8_t const* row = clear_row;
+#if defined(ABG_BANDS)
+            row += page ^ 4;
+#else
+            row += page;
+#endif
+            for(uint8_t i = n; i-- != 0;)
+                paintPages_(image + 128 * i, page + i, (uint16_t(row[i]) << 8) | 1,
+                    (pages & 0xff00) + ((n - 1 - i) << 8) + 1, mask);
+            return;
+        }
+#endif
         
-                ; main loop: send buffer in reverse direction, masking bytes
-            1:  ld   r21, -X
-                mov  r19, r21
-                cpse r22, __zero_reg__
-                mov  r19, r23
-                st   X, r19
-                lpm
-                rjmp .+0
-                and  r21, r18
-                out  %[spdr], r21
-                sbiw r24, 1
-                brne 1b
-                
-                ; delay for final byte, then reset SPCR DORD and clear SPIF
-                rcall 2f
-                rcall 2f
-                ldi  r19, %[DORD2]
-                in   __tmp_reg__, %[spsr]
-                out  %[spcr], r19
-            2:  ret
+        // end of the overlay rows that fall in this paint, as bytes are
+        // sent in reverse
+        uint8_t const* ovl = overlay_data +
+            uint16_t(w) * 2 * (uint16_t(overlay_pages) * currentPlane() + (hi - overlay_page));
+        uint8_t segs = hi - lo;
         
-            )ASM"
-            
-            :
-            : [spdr]    "I"   (_SFR_IO_ADDR(SPDR)),
-              [spsr]    "I"   (_SFR_IO_ADDR(SPSR)),
-              [spcr]    "I"   (_SFR_IO_ADDR(SPCR)),
-              [DORD1]   "i"   (_BV(SPE) | _BV(MSTR) | _BV(DORD)),
-              [DORD2]   "i"   (_BV(SPE) | _BV(MSTR))
-            );
+        Display::paintOverlay(image, clear, pages, mask,
+            ovl, overlay_x, w, page + n - hi, segs, overlay_progmem);
+    }
+#else
+    static void paintPages_(uint8_t* image, uint8_t page, uint16_t clear, uint16_t pages, uint8_t mask)
+    {
+        paintClear(image, page, clear, pages, mask);
+    }
+#endif
+    
+    static void paintPages(uint8_t* image, uint8_t page, uint16_t clear, uint16_t pages, uint8_t mask)
+    {
+#if defined(ABG_TRACE)
+        uint8_t arg = (uint8_t(pages) << 4) | page;
+        trace_(trace_paint, arg);
+        paintPages_(image, page, clear, pages, mask);
+        trace_(trace_paint | trace_end, arg);
+#else
+        paintPages_(image, page, clear, pages, mask);
 #endif
     }
-        
+    
+public:
+    
+    // 1 if color lights plane in the mode, else 0. Public so that plane
+    // data drawn outside the buffer (e.g., setOverlay() tables) can be
+    // built from it, at compile time with planeColor<PLANE>().
+    //
     // Plane                               0  1  2
     // ============================================
     //
@@ -983,22 +2539,38 @@ protected:
     // ABG_Mode::L3            BLACK       .  .
     // ABG_Mode::L3            GRAY        X  .
     // ABG_Mode::L3            WHITE       X  X
+    //
+    // ABG_Mode::L8_Binary     color c     bit 0 of c, bit 1, bit 2
 
     template<uint8_t PLANE>
     static constexpr uint8_t planeColor(uint8_t color)
     {
         return
+            MODE == ABG_Mode::Runtime     ? planeColor(PLANE, color) :
             MODE == ABG_Mode::L4_Contrast ? ((color & (PLANE + 1)) ? 1 : 0) :
             MODE == ABG_Mode::L4_Triplane ? ((color > PLANE) ? 1 : 0) :
             MODE == ABG_Mode::L3          ? ((color > PLANE) ? 1 : 0) :
+            MODE == ABG_Mode::L8_Binary   ? ((color >> PLANE) & 1) :
             0;
     }
 
     static uint8_t planeColor(uint8_t plane, uint8_t color)
     {
+        if(MODE == ABG_Mode::Runtime)
+        {
+            // bit c of each entry is set if color c lights the plane
+            static uint8_t const PLANE_COLORS[3][3] PROGMEM =
+            {
+                { 0x0a, 0x0c, 0x00 }, // L4_Contrast
+                { 0x0e, 0x0c, 0x08 }, // L4_Triplane
+                { 0x0e, 0x0c, 0x00 }, // L3
+            };
+            uint8_t t = pgm_read_byte(&PLANE_COLORS[uint8_t(runtime_mode)][plane]);
+            return (t >> (color & 3)) & 1;
+        }
         if(plane == 0)
             return planeColor<0>(color);
-        else if(plane == 1 || MODE != ABG_Mode::L4_Triplane)
+        else if(plane == 1 || num_planes(MODE) < 3)
             return planeColor<1>(color);
         else
             return planeColor<2>(color);
@@ -1082,6 +2654,31 @@ using ArduboyG     = ArduboyG_Config<>;
 namespace abg_detail
 {
 
+#if defined(ABG_OVERLAY)
+uint8_t const* overlay_data;
+uint8_t  overlay_x;
+uint8_t  overlay_page;
+uint8_t  overlay_w;
+uint8_t  overlay_pages;
+bool     overlay_progmem;
+#endif
+#if defined(ABG_CLEAR_PATTERN)
+uint8_t const* clear_pattern;
+uint8_t const* clear_row;
+#endif
+#if defined(ABG_BANDS)
+uint8_t  band_buffer[512];
+uint8_t  band_y = 32;
+#endif
+#if defined(ABG_RUNTIME_REFRESH)
+uint16_t timer_counter = timer_counter_for(ABG_REFRESH_HZ);
+uint16_t refresh_hz = ABG_REFRESH_HZ;
+#endif
+#if defined(ABG_UPDATE_HZ_DEFAULT)
+uint8_t  update_hz = ABG_UPDATE_HZ_DEFAULT;
+#else
+uint8_t  update_hz;
+#endif
 uint8_t  update_counter;
 uint8_t  update_every_n = ABG_UPDATE_EVERY_N_DEFAULT;
 uint8_t  update_every_n_denom = ABG_UPDATE_EVERY_N_DENOM_DEFAULT;
@@ -1093,6 +2690,45 @@ bool volatile needs_display;
 uint8_t  contrast = ABG_CONTRAST_DEFAULT;
 uint8_t  plane_contrast_L4[3] = { 25, 85, 255 };
 uint8_t  plane_contrast_L3[2] = { 64, 255 };
+#if defined(ABG_EVENTS)
+ABG_Event event_ring[ABG_EVENT_RING_SIZE];
+uint8_t volatile event_head;
+uint8_t volatile event_tail;
+uint8_t  event_seq;
+uint8_t  event_next_seq;
+ABG_EventStats event_stats;
+void (*event_handler)(ABG_Event const&);
+#endif
+#if defined(ABG_PROFILE) || defined(ABG_TRACE)
+uint16_t volatile profile_ticks;
+#endif
+#if defined(ABG_PROFILE)
+ABG_Profile profile_stats;
+uint8_t  volatile profile_isrs;
+uint16_t profile_display_end;
+#endif
+#if defined(ABG_TRACE)
+trace_entry trace_ring[ABG_TRACE_SIZE];
+uint8_t  trace_index;
+bool     trace_paused;
+#endif
+#if defined(ABG_GOVERNOR)
+uint8_t  governor_level;
+uint8_t  governor_headroom;
+uint8_t  governor_hold;
+uint8_t  governor_update_every_n = ABG_UPDATE_EVERY_N_DEFAULT;
+#endif
+ABG_Mode    runtime_mode = ABG_Mode::Default;
+ABG_Mode    requested_mode = ABG_Mode::Default;
+ABG_Convert requested_convert = ABG_CONVERT_DEFAULT;
+ABG_Convert plane_convert = ABG_CONVERT_DEFAULT;
+uint8_t     plane_limit = ABG_L4_TRIPLANE_PLANE_LIMIT;
+#if defined(ABG_SYNC_PARK_ROW)
+bool binary_planes;
+uint8_t volatile binary_index = binary_events - 1;
+uint8_t volatile binary_plane;
+bool volatile binary_park_pending;
+#endif
 
 void send_cmds_(uint8_t const* d, uint8_t n)
 {
@@ -1109,6 +2745,68 @@ void send_cmds_prog_(uint8_t const* d, uint8_t n)
     Arduboy2Base::LCDDataMode();
 }
 
+#if defined(ABG_SYNC_PARK_ROW)
+// Advances the L8_Binary schedule from the frame ISR and returns the
+// timer TOP to program, which applies after the next ISR.
+uint16_t binary_isr_()
+{
+    uint8_t i = binary_index + 1;
+    if(i >= binary_events) i = 0;
+    binary_index = i;
+    uint8_t e = binary_event(i);
+    if(e & binary_display)
+    {
+        binary_plane = (e >> 2) & 3;
+        needs_display = true;
+#if defined(ABG_PROFILE)
+        ++profile_isrs;
+#endif
+    }
+    else if(e & binary_park)
+        binary_park_pending = true;
+    if(++i >= binary_events) i = 0;
+    return binary_top(i);
+}
+#endif
+
+#if defined(ABG_PROFILE)
+// timer ticks to microseconds, saturating at 0xffff
+static uint16_t profile_us(uint16_t ticks)
+{
+    uint32_t us = uint32_t(ticks) * timer_tick_us;
+    return us > 0xffff ? 0xffff : uint16_t(us);
+}
+
+void profile_plane_(uint16_t render, uint16_t idle, uint16_t total)
+{
+    static uint32_t render_sum;
+    static uint32_t idle_sum;
+    static uint32_t total_sum;
+    static uint16_t render_min = 0xffff;
+    static uint16_t render_max;
+    static uint8_t  n;
+    
+    render_sum += render;
+    idle_sum += idle;
+    total_sum += total;
+    if(render < render_min) render_min = render;
+    if(render > render_max) render_max = render;
+    if(++n < ABG_PROFILE_WINDOW)
+        return;
+    
+    profile_stats.render_min = profile_us(render_min);
+    profile_stats.render_avg = profile_us(uint16_t(render_sum / n));
+    profile_stats.render_max = profile_us(render_max);
+    profile_stats.idle_percent = total_sum == 0 ? 0 :
+        uint8_t(idle_sum * 100 / total_sum);
+    
+    render_sum = idle_sum = total_sum = 0;
+    render_min = 0xffff;
+    render_max = 0;
+    n = 0;
+}
+#endif
+
 }
 
 #if defined(ABG_TIMER3)
@@ -1116,6 +2814,15 @@ void send_cmds_prog_(uint8_t const* d, uint8_t n)
 ISR(TIMER3_COMPA_vect)
 {
     using namespace abg_detail;
+#if defined(ABG_EVENTS)
+    event_push_();
+#endif
+#if defined(ABG_PROFILE) || defined(ABG_TRACE)
+    profile_ticks += profile_period();
+#endif
+#if defined(ABG_TRACE)
+    trace_isr_();
+#endif
 #if defined(ABG_SYNC_THREE_PHASE)
     if(++current_phase >= 4)
         current_phase = 1;
@@ -1126,7 +2833,17 @@ ISR(TIMER3_COMPA_vect)
     else if(current_phase == 3)
         OCR3A = (timer_counter >> 4) + 1; // phase 1 delay: 4 lines
 #elif defined(ABG_SYNC_PARK_ROW) || defined(ABG_SYNC_SLOW_DRIVE)
+#if defined(ABG_SYNC_PARK_ROW)
+    if(binary_planes)
+    {
+        OCR3A = binary_isr_();
+        return;
+    }
+#endif
     OCR3A = timer_counter;
+#endif
+#if defined(ABG_PROFILE)
+    ++profile_isrs;
 #endif
     needs_display = true;
 }
@@ -1136,6 +2853,15 @@ ISR(TIMER3_COMPA_vect)
 ISR(TIMER1_COMPA_vect)
 {
     using namespace abg_detail;
+#if defined(ABG_EVENTS)
+    event_push_();
+#endif
+#if defined(ABG_PROFILE) || defined(ABG_TRACE)
+    profile_ticks += profile_period();
+#endif
+#if defined(ABG_TRACE)
+    trace_isr_();
+#endif
 #if defined(ABG_SYNC_THREE_PHASE)
     if(++current_phase >= 4)
         current_phase = 1;
@@ -1146,7 +2872,17 @@ ISR(TIMER1_COMPA_vect)
     else if(current_phase == 3)
         OCR1A = (timer_counter >> 4) + 1; // phase 1 delay: 4 lines
 #elif defined(ABG_SYNC_PARK_ROW) || defined(ABG_SYNC_SLOW_DRIVE)
+#if defined(ABG_SYNC_PARK_ROW)
+    if(binary_planes)
+    {
+        OCR1A = binary_isr_();
+        return;
+    }
+#endif
     OCR1A = timer_counter;
+#endif
+#if defined(ABG_PROFILE)
+    ++profile_isrs;
 #endif
     needs_display = true;
 }
@@ -1156,6 +2892,15 @@ ISR(TIMER1_COMPA_vect)
 ISR(TIMER4_OVF_vect)
 {
     using namespace abg_detail;
+#if defined(ABG_EVENTS)
+    event_push_();
+#endif
+#if defined(ABG_PROFILE) || defined(ABG_TRACE)
+    profile_ticks += profile_period();
+#endif
+#if defined(ABG_TRACE)
+    trace_isr_();
+#endif
 #if defined(ABG_SYNC_THREE_PHASE)
     if(++current_phase >= 4)
         current_phase = 1;
@@ -1169,12 +2914,47 @@ ISR(TIMER4_OVF_vect)
     TC4H = (top >> 8);
     OCR4C = top;
 #elif defined(ABG_SYNC_PARK_ROW) || defined(ABG_SYNC_SLOW_DRIVE)
-    TC4H = (timer_counter >> 8);
-    OCR4C = timer_counter;
+    uint16_t top = timer_counter;
+#if defined(ABG_SYNC_PARK_ROW)
+    if(binary_planes)
+    {
+        top = binary_isr_();
+        TC4H = (top >> 8);
+        OCR4C = top;
+        return;
+    }
+#endif
+    TC4H = (top >> 8);
+    OCR4C = top;
+#endif
+#if defined(ABG_PROFILE)
+    ++profile_isrs;
 #endif
     needs_display = true;
 }
 
 #endif
 
+#if !defined(ARDUINO_ARCH_AVR)
+uint8_t  abg_detail::Display_Host::out[2048];
+uint16_t abg_detail::Display_Host::out_count;
+
+uint8_t  abg_host::sreg;
+uint8_t  abg_host::tc4h;
+uint8_t  abg_host::control;
+uint16_t abg_host::tcnt;
+uint16_t abg_host::ocr;
+
+void (abg_host::sleep_cpu)()
+{
+#if defined(ABG_TIMER3)
+    TIMER3_COMPA_vect();
+#elif defined(ABG_TIMER1)
+    TIMER1_COMPA_vect();
+#elif defined(ABG_TIMER4)
+    TIMER4_OVF_vect();
+#endif
+}
+#endif
+
 #endif // ABG_IMPLEMENTATION
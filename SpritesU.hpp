@@ -6,16 +6,67 @@ Options
     SPRITESU_PLUSMASK
     SPRITESU_FX
     SPRITESU_RECT
+    SPRITESU_TILEMAP
+    SPRITESU_BAND
+        Draw into the 4-page band buffer of ArduboyG (ABG_BANDS) instead
+        of Arduboy2Base::sBuffer, clipping to the band being rendered.
+        ArduboyG.h must be included first. Coordinates stay relative to
+        the full screen, but drawBasicNoChecks() callers must make sure
+        the sprite overlaps the band.
+
+    With ABG_VIEWPORT_PAGES defined by ArduboyG, SpritesU draws into the
+    viewport pages at the bottom of Arduboy2Base::sBuffer, with y = 0 at
+    the top of the viewport, and clips to the viewport height.
 */
 
 #pragma once
 
 #if defined(SPRITESU_FX)
 #include <ArduboyFX.h>
-#else
+#elif defined(ARDUINO_ARCH_AVR)
 using uint24_t = __uint24;
+#else
+// wide enough to carry a PROGMEM pointer on hosts without __uint24
+using uint24_t = uintptr_t;
 #endif
 
+#if defined(SPRITESU_BAND)
+#define SPRITESU_BUFFER abg_detail::band_buffer
+#define SPRITESU_HEIGHT 32
+#define SPRITESU_BAND_Y abg_detail::band_y
+#elif defined(ABG_VIEWPORT_PAGES)
+#define SPRITESU_BUFFER (Arduboy2Base::sBuffer + 128 * (8 - ABG_VIEWPORT_PAGES))
+#define SPRITESU_HEIGHT (ABG_VIEWPORT_PAGES * 8)
+#define SPRITESU_BAND_Y 0
+#else
+#define SPRITESU_BUFFER Arduboy2Base::sBuffer
+#define SPRITESU_HEIGHT 64
+#define SPRITESU_BAND_Y 0
+#endif
+
+// from Mr. Blinky's ArduboyFX library
+static __attribute__((always_inline)) uint8_t SpritesU_bitShiftLeftUInt8(uint8_t bit)
+{
+#ifdef ARDUINO_ARCH_AVR
+    uint8_t result;
+    asm volatile(
+        "ldi    %[result], 1    \n" // 0 = 000 => 0000 0001
+        "sbrc   %[bit], 1       \n" // 1 = 001 => 0000 0010
+        "ldi    %[result], 4    \n" // 2 = 010 => 0000 0100
+        "sbrc   %[bit], 0       \n" // 3 = 011 => 0000 1000
+        "lsl    %[result]       \n"
+        "sbrc   %[bit], 2       \n" // 4 = 100 => 0001 0000
+        "swap   %[result]       \n" // 5 = 101 => 0010 0000
+        :[result] "=&d" (result)    // 6 = 110 => 0100 0000
+        :[bit]    "r"   (bit)       // 7 = 111 => 1000 0000
+        :
+    );
+    return result;
+#else
+    return 1 << (bit & 7);
+#endif
+}
+
 struct SpritesU
 {
 #ifdef SPRITESU_OVERWRITE
@@ -23,6 +74,22 @@ struct SpritesU
         int16_t x, int16_t y, uint8_t const* image, uint16_t frame);
     static void drawOverwrite(
         int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t const* image);
+    
+    // Size-specialised drawOverwrite for a W x H sprite (H a multiple of
+    // 8, both at most 32), such as drawOverwrite<16, 16>(x, y, image,
+    // frame). image includes the w/h header. A sprite that is entirely
+    // on screen is drawn by a kernel with fully unrolled columns and
+    // pages; otherwise it falls back to drawBasic(). drawOverwrite_i8 is
+    // for sprites known to be near the screen, as fillRect_i8.
+    template<uint8_t W, uint8_t H>
+    static void drawOverwrite(
+        int16_t x, int16_t y, uint8_t const* image, uint16_t frame);
+    template<uint8_t W, uint8_t H>
+    static void drawOverwrite_i8(
+        int8_t x, int8_t y, uint8_t const* image, uint16_t frame);
+    template<uint8_t W, uint8_t H>
+    static void drawOverwriteUnrolled(
+        uint8_t x, uint8_t y, uint8_t const* image);
 #endif
 
 #ifdef SPRITESU_PLUSMASK
@@ -30,6 +97,24 @@ struct SpritesU
         int16_t x, int16_t y, uint8_t const* image, uint16_t frame);
     static void drawPlusMask(
         int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t const* image);
+    
+    // Draws a sprite converted with preshifted=True, which stores 8
+    // plus-mask copies of each frame shifted down by 0 to 7 rows. The
+    // copy for y & 7 is drawn page-aligned, so every byte is a plain
+    // mask-and-store with no multiply or second page.
+    static void drawPreShifted(
+        int16_t x, int16_t y, uint8_t const* image, uint16_t frame);
+    
+    // Draws one plane of a grayscale sprite converted with
+    // shared_mask=True, which stores each frame's mask once followed by
+    // the image bytes of its planes, instead of a mask per plane.
+    // frame counts sprite frames, not frame * planes + plane as with
+    // drawPlusMask. It runs the drawPlusMask kernel, reading each image
+    // byte at a fixed offset from its mask byte for 4 more cycles per
+    // byte.
+    static void drawPlusMaskShared(
+        int16_t x, int16_t y, uint8_t const* image, uint16_t frame,
+        uint8_t planes, uint8_t plane);
 #endif
 
 #if defined(SPRITESU_OVERWRITE) || defined(SPRITESU_PLUSMASK)
@@ -52,6 +137,13 @@ struct SpritesU
         int16_t x, int16_t y, uint24_t image, uint16_t frame);
     static void drawSelfMaskFX(
         int16_t x, int16_t y, uint8_t w, uint8_t h, uint24_t image, uint16_t frame);
+    
+    // drawPlusMaskShared for a sprite in FX data. It clears the buffer
+    // under the mask, then ORs in the plane, so it costs about a
+    // drawSelfMaskFX per pass.
+    static void drawPlusMaskSharedFX(
+        int16_t x, int16_t y, uint24_t image, uint16_t frame,
+        uint8_t planes, uint8_t plane);
 #endif
 
 #ifdef SPRITESU_RECT
@@ -60,13 +152,45 @@ struct SpritesU
     static void fillRect_i8(int8_t x, int8_t y, uint8_t w, uint8_t h, uint8_t color);
 #endif
 
-    static constexpr uint8_t MODE_OVERWRITE   = 0;
-    static constexpr uint8_t MODE_PLUSMASK    = 1;
-    static constexpr uint8_t MODE_SELFMASK    = 4;
-    static constexpr uint8_t MODE_OVERWRITEFX = 2;
-    static constexpr uint8_t MODE_PLUSMASKFX  = 3;
-    static constexpr uint8_t MODE_SELFMASKFX  = 6;
+#ifdef SPRITESU_TILEMAP
+    // Draws a map_w x map_h grid of tiles with its top-left corner at (x, y).
+    // tilemap: PROGMEM tile indices, row-major
+    // tileset: sprite whose frames are grouped as tile * planes + plane
+    // Tile height must be a multiple of 8.
+    static void drawTilemap(
+        int16_t x, int16_t y,
+        uint8_t const* tilemap, uint8_t map_w, uint8_t map_h,
+        uint8_t const* tileset, uint8_t planes, uint8_t plane);
+#endif
 
+    static constexpr uint8_t MODE_OVERWRITE      = 0;
+    static constexpr uint8_t MODE_PLUSMASK       = 1;
+    static constexpr uint8_t MODE_SELFMASK       = 4;
+    static constexpr uint8_t MODE_OVERWRITEFX    = 2;
+    static constexpr uint8_t MODE_PLUSMASKFX     = 3;
+    static constexpr uint8_t MODE_SELFMASKFX     = 6;
+
+    // Kernels for the drawPlusMaskShared functions. MODE_PLUSMASKSHARED
+    // reads each mask byte at image and its image byte plane_offset
+    // bytes after it. MODE_ERASEFX clears the buffer bits set in an FX
+    // mask plane.
+    static constexpr uint8_t MODE_PLUSMASKSHARED = 8;
+    static constexpr uint8_t MODE_ERASEFX        = 10;
+
+    // Each MODE_* instantiates its own kernel with the mode-dependent clip
+    // arithmetic resolved at compile time, so a program links only the
+    // kernels for the modes it draws with. The versions taking mode at
+    // runtime dispatch to them.
+    template<uint8_t MODE>
+    static void drawBasic(
+        int16_t x, int16_t y, uint8_t w, uint8_t h,
+        uint24_t image, uint16_t frame);
+    template<uint8_t MODE>
+    static void drawBasicNoChecks(
+        uint16_t w_and_h,
+        uint24_t image,
+        int16_t x, int16_t y,
+        uint16_t plane_offset = 0);
     static void drawBasic(
         int16_t x, int16_t y, uint8_t w, uint8_t h,
         uint24_t image, uint16_t frame, uint8_t mode);
@@ -74,41 +198,222 @@ struct SpritesU
         uint16_t w_and_h,
         uint24_t image, uint8_t mode,
         int16_t x, int16_t y);
+
+    // A PROGMEM sprite whose size and format are known at compile time, as
+    // emitted by convert_sprite.py. Drawing through a Sprite skips reading
+    // w and h from the image header and folds the frame offset into a
+    // constant multiply (a shift for power-of-2 strides).
+    //   MODE:   MODE_OVERWRITE for image bytes only, MODE_PLUSMASK for
+    //           interleaved image and mask bytes
+    //   STRIDE: bytes per frame
+    template<uint8_t W, uint8_t H, uint8_t MODE,
+        uint16_t STRIDE = uint16_t((H + 7) / 8) * W * (MODE == MODE_PLUSMASK ? 2 : 1)>
+    struct Sprite
+    {
+        static_assert(MODE == MODE_OVERWRITE || MODE == MODE_PLUSMASK,
+            "Sprite MODE must be MODE_OVERWRITE or MODE_PLUSMASK");
+        static constexpr uint8_t  w = W;
+        static constexpr uint8_t  h = H;
+        static constexpr uint8_t  mode = MODE;
+        static constexpr uint16_t stride = STRIDE;
+        uint8_t const* image; // frame 0, after the w and h header
+        
+        uint8_t const* frame(uint16_t f) const { return image + f * STRIDE; }
+    };
+
+#ifdef SPRITESU_OVERWRITE
+    template<uint8_t W, uint8_t H, uint8_t MODE, uint16_t STRIDE>
+    static void drawOverwrite(
+        int16_t x, int16_t y, Sprite<W, H, MODE, STRIDE> const& s, uint16_t frame)
+    {
+        static_assert(MODE == MODE_OVERWRITE, "drawOverwrite needs an unmasked Sprite");
+        drawBasic<MODE_OVERWRITE>(x, y, W, H, (uint24_t)s.frame(frame), 0);
+    }
+#endif
+
+#ifdef SPRITESU_PLUSMASK
+    template<uint8_t W, uint8_t H, uint8_t MODE, uint16_t STRIDE>
+    static void drawPlusMask(
+        int16_t x, int16_t y, Sprite<W, H, MODE, STRIDE> const& s, uint16_t frame)
+    {
+        static_assert(MODE == MODE_PLUSMASK, "drawPlusMask needs a masked Sprite");
+        drawBasic<MODE_PLUSMASK>(x, y, W, H, (uint24_t)s.frame(frame), 0);
+    }
+#endif
+
+#if defined(SPRITESU_OVERWRITE) || defined(SPRITESU_PLUSMASK)
+    template<uint8_t W, uint8_t H, uint8_t MODE, uint16_t STRIDE>
+    static void drawSelfMask(
+        int16_t x, int16_t y, Sprite<W, H, MODE, STRIDE> const& s, uint16_t frame)
+    {
+        static_assert(MODE == MODE_OVERWRITE, "drawSelfMask needs an unmasked Sprite");
+        drawBasic<MODE_SELFMASK>(x, y, W, H, (uint24_t)s.frame(frame), 0);
+    }
+#endif
 };
 
-#ifdef SPRITESU_IMPLEMENTATION
+#ifdef SPRITESU_OVERWRITE
+template<uint8_t W, uint8_t H>
+void SpritesU::drawOverwrite(
+    int16_t x, int16_t y, uint8_t const* image, uint16_t frame)
+{
+    image += 2 + frame * uint16_t(H / 8 * W);
+    int16_t by = y - SPRITESU_BAND_Y;
+    if(uint16_t(x) <= 128 - W && uint16_t(by) <= SPRITESU_HEIGHT - H)
+        drawOverwriteUnrolled<W, H>(uint8_t(x), uint8_t(by), image);
+    else
+        drawBasic<MODE_OVERWRITE>(x, y, W, H, (uint24_t)image, 0);
+}
 
-// from Mr. Blinky's ArduboyFX library
-static __attribute__((always_inline)) uint8_t SpritesU_bitShiftLeftUInt8(uint8_t bit)
+template<uint8_t W, uint8_t H>
+void SpritesU::drawOverwrite_i8(
+    int8_t x, int8_t y, uint8_t const* image, uint16_t frame)
+{
+    image += 2 + frame * uint16_t(H / 8 * W);
+    uint8_t by = uint8_t(y - SPRITESU_BAND_Y);
+    if(uint8_t(x) <= 128 - W && by <= SPRITESU_HEIGHT - H)
+        drawOverwriteUnrolled<W, H>(uint8_t(x), by, image);
+    else
+        drawBasic<MODE_OVERWRITE>(x, y, W, H, (uint24_t)image, 0);
+}
+
+// x and y (relative to SPRITESU_BUFFER) must keep the sprite on screen
+template<uint8_t W, uint8_t H>
+__attribute__((noinline))
+void SpritesU::drawOverwriteUnrolled(
+    uint8_t x, uint8_t y, uint8_t const* image)
 {
+    static_assert(W >= 1 && W <= 32 && H >= 8 && H <= 32 && H % 8 == 0,
+        "drawOverwrite<W, H> needs W up to 32 and H a multiple of 8 up to 32");
+    
+    uint8_t* buf = SPRITESU_BUFFER + uint16_t(y >> 3) * 128 + x;
+    uint8_t shift_coef = SpritesU_bitShiftLeftUInt8(y);
+    
+    if(shift_coef == 1)
+    {
 #ifdef ARDUINO_ARCH_AVR
-    uint8_t result;
-    asm volatile(
-        "ldi    %[result], 1    \n" // 0 = 000 => 0000 0001
-        "sbrc   %[bit], 1       \n" // 1 = 001 => 0000 0010
-        "ldi    %[result], 4    \n" // 2 = 010 => 0000 0100
-        "sbrc   %[bit], 0       \n" // 3 = 011 => 0000 1000
-        "lsl    %[result]       \n"
-        "sbrc   %[bit], 2       \n" // 4 = 100 => 0001 0000
-        "swap   %[result]       \n" // 5 = 101 => 0010 0000
-        :[result] "=&d" (result)    // 6 = 110 => 0100 0000
-        :[bit]    "r"   (bit)       // 7 = 111 => 1000 0000
+        asm volatile(R"ASM(
+                
+                .rept %[pages]
+                
+                ; copy one page from image to buf
+                .rept %[w]
+                lpm __tmp_reg__, %a[image]+
+                st %a[buf]+, __tmp_reg__
+                .endr
+                
+                ; advance buf to the next page
+                subi %A[buf], lo8(-(128 - %[w]))
+                sbci %B[buf], hi8(-(128 - %[w]))
+                
+                .endr
+                
+            )ASM"
+            :
+            [buf]   "+&x" (buf),
+            [image] "+&z" (image)
+            :
+            [pages] "n"   (H / 8),
+            [w]     "n"   (W)
+            :
+            "memory"
+            );
+#else
+        for(uint8_t p = 0; p < H / 8; ++p)
+        {
+            for(uint8_t i = 0; i < W; ++i)
+                *buf++ = pgm_read_byte(image++);
+            buf += 128 - W;
+        }
+#endif
+        return;
+    }
+    
+    // every source page is split across buf and buf+128
+    uint16_t shift_mask = ~(uint16_t(0xff) * shift_coef);
+#ifdef ARDUINO_ARCH_AVR
+    uint8_t buf_data;
+    asm volatile(R"ASM(
+            
+            ; need Y pointer for buf+128
+            push r28
+            push r29
+            movw r28, %[buf]
+            subi r28, lo8(-128)
+            sbci r29, hi8(-128)
+            
+            .rept %[pages]
+            
+            ; write one page from image to buf/buf+128
+            .rept %[w]
+            lpm %[buf_data], %a[image]+
+            mul %[buf_data], %[shift_coef]
+            ld %[buf_data], %a[buf]
+            and %[buf_data], %A[shift_mask]
+            or %[buf_data], r0
+            st %a[buf]+, %[buf_data]
+            ld %[buf_data], Y
+            and %[buf_data], %B[shift_mask]
+            or %[buf_data], r1
+            st Y+, %[buf_data]
+            .endr
+            
+            ; advance buf and buf+128 to the next page
+            subi %A[buf], lo8(-(128 - %[w]))
+            sbci %B[buf], hi8(-(128 - %[w]))
+            subi r28, lo8(-(128 - %[w]))
+            sbci r29, hi8(-(128 - %[w]))
+            
+            .endr
+            
+            ; done with Y pointer
+            pop r29
+            pop r28
+            clr __zero_reg__
+            
+        )ASM"
         :
-    );
-    return result;
+        [buf]        "+&x" (buf),
+        [image]      "+&z" (image),
+        [buf_data]   "=&r" (buf_data)
+        :
+        [shift_mask] "r"   (shift_mask),
+        [shift_coef] "r"   (shift_coef),
+        [pages]      "n"   (H / 8),
+        [w]          "n"   (W)
+        :
+        "r28", "r29", "memory"
+        );
 #else
-    return 1 << (bit & 7);
+    for(uint8_t p = 0; p < H / 8; ++p)
+    {
+        for(uint8_t i = 0; i < W; ++i)
+        {
+            uint16_t t = pgm_read_byte(image++) * shift_coef;
+            buf[0]   = (buf[0]   & uint8_t(shift_mask >> 0)) | uint8_t(t >> 0);
+            buf[128] = (buf[128] & uint8_t(shift_mask >> 8)) | uint8_t(t >> 8);
+            ++buf;
+        }
+        buf += 128 - W;
+    }
 #endif
 }
+#endif
+
+#ifdef SPRITESU_IMPLEMENTATION
 
+template<uint8_t MODE>
 void SpritesU::drawBasic(
     int16_t x, int16_t y, uint8_t w, uint8_t h,
-    uint24_t image, uint16_t frame, uint8_t mode)
+    uint24_t image, uint16_t frame)
 {
+    {
+    int16_t by = y - SPRITESU_BAND_Y;
     if(x >= 128) return;
-    if(y >= 64)  return;
+    if(by >= SPRITESU_HEIGHT) return;
     if(x + w <= 0) return;
-    if(y + h <= 0) return;
+    if(by + h <= 0) return;
+    }
     
     uint8_t oldh = h;    
     
@@ -136,8 +441,9 @@ void SpritesU::drawBasic(
             lsr  %[h]
             lsr  %[h]
             lsr  %[h]
-            sbrc %[mode], 0
+            .if  %[mode] & 1
             lsl  %A[h]
+            .endif
             mul  %A[h], %[w]
             movw %A[tmp], r0
             
@@ -163,27 +469,30 @@ void SpritesU::drawBasic(
         [tmp]   "=&r" (tmp)
         :
         [frame] "r"   (frame),
-        [mode]  "r"   (mode),
+        [mode]  "n"   (MODE),
         [w]     "r"   (w)
         );
 #else
     if(frame != 0)
     {
         h >>= 3;
-        if(mode & 1) h <<= 1;
+        if(MODE & 1) h <<= 1;
         uint16_t tmp = h * w;
         image += uint24_t(tmp) * frame;
     }
 #endif
 
-    drawBasicNoChecks((uint16_t(oldh) << 8) | w, image, mode, x, y);
+    drawBasicNoChecks<MODE>((uint16_t(oldh) << 8) | w, image, x, y);
 }
 
+template<uint8_t MODE>
 void SpritesU::drawBasicNoChecks(
     uint16_t w_and_h,
-    uint24_t image, uint8_t mode,
-    int16_t x, int16_t y)
+    uint24_t image,
+    int16_t x, int16_t y,
+    uint16_t plane_offset)
 {
+    constexpr uint8_t mode = MODE;
     uint8_t* buf;
     uint8_t pages;
     uint8_t count;
@@ -205,8 +514,9 @@ void SpritesU::drawBasicNoChecks(
     
     w = uint8_t(w_and_h);
     h = uint8_t(w_and_h >> 8);
-    buf = Arduboy2Base::sBuffer;
+    buf = SPRITESU_BUFFER;
     pages = h;
+    y -= SPRITESU_BAND_Y;
     
 #ifdef ARDUINO_ARCH_AVR
     asm volatile(R"ASM(
@@ -229,14 +539,13 @@ void SpritesU::drawBasicNoChecks(
             clr  %A[shift_mask]
             com  %A[shift_mask]
             mov  %B[shift_mask], %A[shift_mask]
-            sbrc %[mode], 2
-            rjmp 1f
+            .if  (%[mode] & 4) == 0
             ldi  %[buf_adv], 0xff
             mul  %[buf_adv], %[shift_coef]
             movw %A[shift_mask], r0
             com  %A[shift_mask]
             com  %B[shift_mask]
-        1:
+            .endif
             
             asr  %B[y]
             ror  %A[y]
@@ -251,8 +560,9 @@ void SpritesU::drawBasicNoChecks(
             brge 2f
             com  %[page_start]
             sub  %[pages], %[page_start]
-            sbrc %[mode], 0
+            .if  %[mode] & 1
             lsl  %[page_start]
+            .endif
             mul  %[page_start], %[w]
             add  %A[image], r0
             adc  %B[image], r1
@@ -263,11 +573,10 @@ void SpritesU::drawBasicNoChecks(
             sbrs %B[x], 7
             rjmp 4f
             add %[cols], %A[x]
-            sbrs %[mode], 0
-            rjmp 3f
+            .if  %[mode] & 1
             lsl  %A[x]
             rol  %B[x]
-        3:
+            .endif
             sub  %A[image], %A[x]
             sbc  %B[image], %B[x]
             sbc  %C[image], %[bottom]
@@ -289,7 +598,7 @@ void SpritesU::drawBasicNoChecks(
             mov  %[cols], %[buf_adv]
         5:
             ; clip against bottom edge
-            ldi  %[buf_adv], 7
+            ldi  %[buf_adv], %[last_page]
             sub  %[buf_adv], %[page_start]
             cp   %[buf_adv], %[pages]
             brge 6f
@@ -300,16 +609,14 @@ void SpritesU::drawBasicNoChecks(
             sub  %[buf_adv], %[cols]
             mov  %A[image_adv], %[w]
             clr  %B[image_adv]
-            sbrc %[mode], 1
-            rjmp 7f
+            .if  (%[mode] & 2) == 0
             sub  %A[image_adv], %[cols]
             sbc  %B[image_adv], %B[image_adv]
-        7:
-            sbrs %[mode], 0
-            rjmp 8f
+            .endif
+            .if  %[mode] & 1
             lsl  %A[image_adv]
             rol  %B[image_adv]
-        8:
+            .endif
             clr __zero_reg__
         )ASM"
         :
@@ -327,8 +634,9 @@ void SpritesU::drawBasicNoChecks(
         [y]          "+&r" (y),
         [image]      "+&r" (image)
         :
-        [mode]       "r"   (mode),
-        [w]          "r"   (w)
+        [mode]       "n"   (MODE),
+        [w]          "r"   (w),
+        [last_page]  "M"   (SPRITESU_HEIGHT / 8 - 1)
         );
     
 #else
@@ -378,7 +686,7 @@ void SpritesU::drawBasicNoChecks(
         cols = buf_adv;
 
     // clip against bottom edge
-    buf_adv = 7;
+    buf_adv = SPRITESU_HEIGHT / 8 - 1;
     buf_adv -= page_start;
     if(buf_adv < pages)
     {
@@ -397,8 +705,251 @@ void SpritesU::drawBasicNoChecks(
 
     }
 
-#ifdef SPRITESU_OVERWRITE
-    if(mode == MODE_OVERWRITE)
+    if(shift_coef == 1)
+    {
+        // page-aligned: the top page receives nothing, and every other
+        // source page lands on exactly one buffer page
+        if(page_start < 0)
+        {
+            buf += 128;
+            image += (mode & 1) ? uint16_t(w) * 2 : w;
+            --pages;
+        }
+        pages += bottom;
+        if(pages == 0) return;
+
+#if defined(SPRITESU_OVERWRITE) || defined(SPRITESU_PLUSMASK)
+        if(!(mode & 11)) // MODE_OVERWRITE or MODE_SELFMASK
+        {
+            uint8_t const* image_ptr = (uint8_t const*)image;
+#ifdef ARDUINO_ARCH_AVR
+            asm volatile(R"ASM(
+
+                    .if (%[mode] & 4) == 0
+
+                L%=_overwrite:
+
+                    mov %[count], %[cols]
+
+                L%=_overwrite_loop:
+
+                    ; copy one page from image to buf
+                    lpm __tmp_reg__, %a[image]+
+                    st %a[buf]+, __tmp_reg__
+                    dec %[count]
+                    brne L%=_overwrite_loop
+
+                    ; advance buf and image to the next page
+                    add %A[buf], %[buf_adv]
+                    adc %B[buf], __zero_reg__
+                    add %A[image], %A[image_adv]
+                    adc %B[image], %B[image_adv]
+                    dec %[pages]
+                    brne L%=_overwrite
+
+                    .else
+
+                L%=_selfmask:
+
+                    mov %[count], %[cols]
+
+                L%=_selfmask_loop:
+
+                    ; OR one page from image into buf
+                    lpm %[buf_data], %a[image]+
+                    ld __tmp_reg__, %a[buf]
+                    or __tmp_reg__, %[buf_data]
+                    st %a[buf]+, __tmp_reg__
+                    dec %[count]
+                    brne L%=_selfmask_loop
+
+                    ; advance buf and image to the next page
+                    add %A[buf], %[buf_adv]
+                    adc %B[buf], __zero_reg__
+                    add %A[image], %A[image_adv]
+                    adc %B[image], %B[image_adv]
+                    dec %[pages]
+                    brne L%=_selfmask
+
+                    .endif
+
+                )ASM"
+                :
+                [buf]        "+&x" (buf),
+                [image]      "+&z" (image_ptr),
+                [pages]      "+&r" (pages),
+                [count]      "=&r" (count),
+                [buf_data]   "=&r" (buf_data)
+                :
+                [buf_adv]    "r"   (buf_adv),
+                [image_adv]  "r"   (image_adv),
+                [cols]       "r"   (cols),
+                [mode]       "n"   (MODE)
+                :
+                "memory"
+                );
+#else
+            do
+            {
+                count = cols;
+                if(mode & 4)
+                {
+                    do *buf++ |= pgm_read_byte(image_ptr++);
+                    while(--count != 0);
+                }
+                else
+                {
+                    do *buf++ = pgm_read_byte(image_ptr++);
+                    while(--count != 0);
+                }
+                buf += buf_adv;
+                image_ptr += image_adv;
+            } while(--pages != 0);
+#endif
+        }
+        else
+#endif
+#ifdef SPRITESU_PLUSMASK
+        if(mode == MODE_PLUSMASK || mode == MODE_PLUSMASKSHARED)
+        {
+            uint8_t const* image_ptr = (uint8_t const*)image;
+#ifdef ARDUINO_ARCH_AVR
+            asm volatile(R"ASM(
+
+                L%=_outer:
+
+                    mov %[count], %[cols]
+
+                L%=_inner:
+
+                    ; write one page from image to buf through mask
+                    .if %[mode] & 8
+                    add %A[image], %A[plane_offset]
+                    adc %B[image], %B[plane_offset]
+                    lpm %A[image_data], %a[image]
+                    sub %A[image], %A[plane_offset]
+                    sbc %B[image], %B[plane_offset]
+                    lpm %A[mask_data], %a[image]+
+                    .else
+                    lpm %A[image_data], %a[image]+
+                    lpm %A[mask_data], %a[image]+
+                    .endif
+                    ld %[buf_data], %a[buf]
+                    com %A[mask_data]
+                    and %[buf_data], %A[mask_data]
+                    or %[buf_data], %A[image_data]
+                    st %a[buf]+, %[buf_data]
+                    dec %[count]
+                    brne L%=_inner
+
+                    ; advance buf and image to the next page
+                    add %A[buf], %[buf_adv]
+                    adc %B[buf], __zero_reg__
+                    add %A[image], %A[image_adv]
+                    adc %B[image], %B[image_adv]
+                    dec %[pages]
+                    brne L%=_outer
+
+                )ASM"
+                :
+                [buf]        "+&x" (buf),
+                [image]      "+&z" (image_ptr),
+                [pages]      "+&r" (pages),
+                [count]      "=&r" (count),
+                [buf_data]   "=&r" (buf_data),
+                [image_data] "=&r" (image_data),
+                [mask_data]  "=&r" (mask_data)
+                :
+                [buf_adv]    "r"   (buf_adv),
+                [image_adv]  "r"   (image_adv),
+                [cols]       "r"   (cols),
+                [plane_offset] "r" (plane_offset),
+                [mode]       "n"   (MODE)
+                :
+                "memory"
+                );
+#else
+            do
+            {
+                count = cols;
+                do
+                {
+                    if(mode & 8)
+                    {
+                        image_data = pgm_read_byte(image_ptr + plane_offset);
+                        mask_data = pgm_read_byte(image_ptr++);
+                    }
+                    else
+                    {
+                        image_data = pgm_read_byte(image_ptr++);
+                        mask_data = pgm_read_byte(image_ptr++);
+                    }
+                    buf_data = *buf;
+                    buf_data &= ~uint8_t(mask_data);
+                    buf_data |= uint8_t(image_data);
+                    *buf++ = buf_data;
+                } while(--count != 0);
+                buf += buf_adv;
+                image_ptr += image_adv;
+            } while(--pages != 0);
+#endif
+        }
+        else
+#endif
+#ifdef SPRITESU_FX
+        {
+            // the FX kernels are bound by SPI throughput, so the aligned
+            // path only needs to drop the multiply and second page
+            bool reseek = false;
+            FX::seekData(image);
+            do
+            {
+                if(reseek)
+                {
+                    (void)FX::readEnd();
+                    image += image_adv;
+                    FX::seekData(image);
+                }
+                reseek = (w != cols);
+                count = cols;
+                if(mode & 1)
+                {
+                    do
+                    {
+                        image_data = FX::readPendingUInt8();
+                        mask_data = FX::readPendingUInt8();
+                        buf_data = *buf;
+                        buf_data &= ~uint8_t(mask_data);
+                        buf_data |= uint8_t(image_data);
+                        *buf++ = buf_data;
+                    } while(--count != 0);
+                }
+                else if(mode & 8)
+                {
+                    do *buf++ &= ~FX::readPendingUInt8();
+                    while(--count != 0);
+                }
+                else if(mode & 4)
+                {
+                    do *buf++ |= FX::readPendingUInt8();
+                    while(--count != 0);
+                }
+                else
+                {
+                    do *buf++ = FX::readPendingUInt8();
+                    while(--count != 0);
+                }
+                buf += buf_adv;
+            } while(--pages != 0);
+            (void)FX::readEnd();
+        }
+#endif
+        {} // empty final else block, if needed
+        return;
+    }
+
+#if defined(SPRITESU_OVERWRITE) || defined(SPRITESU_PLUSMASK)
+    if(!(mode & 11)) // MODE_OVERWRITE or MODE_SELFMASK
     {
         uint8_t const* image_ptr = (uint8_t const*)image;
 #ifdef ARDUINO_ARCH_AVR
@@ -579,7 +1130,7 @@ void SpritesU::drawBasicNoChecks(
     else
 #endif
 #ifdef SPRITESU_PLUSMASK
-    if(mode == MODE_PLUSMASK)
+    if(mode == MODE_PLUSMASK || mode == MODE_PLUSMASKSHARED)
     {
         uint8_t const* image_ptr = (uint8_t const*)image;
 #ifdef ARDUINO_ARCH_AVR
@@ -596,8 +1147,17 @@ void SpritesU::drawBasicNoChecks(
             L%=_top_loop:
 
                 ; write one page from image to buf+128
+                .if %[mode] & 8
+                add %A[image], %A[plane_offset]
+                adc %B[image], %B[plane_offset]
+                lpm %A[image_data], %a[image]
+                sub %A[image], %A[plane_offset]
+                sbc %B[image], %B[plane_offset]
+                lpm %A[mask_data], %a[image]+
+                .else
                 lpm %A[image_data], %a[image]+
                 lpm %A[mask_data], %a[image]+
+                .endif
 
                 mul %A[image_data], %[shift_coef]
                 movw %[image_data], r0
@@ -638,8 +1198,17 @@ void SpritesU::drawBasicNoChecks(
 
             L%=_middle_loop_inner:
                 ; write one page from image to buf/buf+128
+                .if %[mode] & 8
+                add %A[image], %A[plane_offset]
+                adc %B[image], %B[plane_offset]
+                lpm %A[image_data], %a[image]
+                sub %A[image], %A[plane_offset]
+                sbc %B[image], %B[plane_offset]
+                lpm %A[mask_data], %a[image]+
+                .else
                 lpm %A[image_data], %a[image]+
                 lpm %A[mask_data], %a[image]+
+                .endif
 
                 mul %A[image_data], %[shift_coef]
                 movw %[image_data], r0
@@ -682,8 +1251,17 @@ void SpritesU::drawBasicNoChecks(
             L%=_bottom_loop:
 
                 ; write one page from image to buf
+                .if %[mode] & 8
+                add %A[image], %A[plane_offset]
+                adc %B[image], %B[plane_offset]
+                lpm %A[image_data], %a[image]
+                sub %A[image], %A[plane_offset]
+                sbc %B[image], %B[plane_offset]
+                lpm %A[mask_data], %a[image]+
+                .else
                 lpm %A[image_data], %a[image]+
                 lpm %A[mask_data], %a[image]+
+                .endif
                 mul %A[image_data], %[shift_coef]
                 movw %[image_data], r0
                 mul %A[mask_data], %[shift_coef]
@@ -716,7 +1294,9 @@ void SpritesU::drawBasicNoChecks(
             [image_adv]  "r"   (image_adv),
             [shift_coef] "r"   (shift_coef),
             [bottom]     "r"   (bottom),
-            [page_start] "r"   (page_start)
+            [page_start] "r"   (page_start),
+            [plane_offset] "r" (plane_offset),
+            [mode]       "n"   (MODE)
             :
             "r28", "r29", "memory"
             );
@@ -727,8 +1307,16 @@ void SpritesU::drawBasicNoChecks(
             count = cols;
             do
             {
-                image_data = pgm_read_byte(image_ptr++);
-                mask_data = pgm_read_byte(image_ptr++);
+                if(mode & 8)
+                {
+                    image_data = pgm_read_byte(image_ptr + plane_offset);
+                    mask_data = pgm_read_byte(image_ptr++);
+                }
+                else
+                {
+                    image_data = pgm_read_byte(image_ptr++);
+                    mask_data = pgm_read_byte(image_ptr++);
+                }
                 image_data = (uint8_t)image_data * shift_coef;
                 mask_data = (uint8_t)mask_data * shift_coef;
                 buf_data = *buf;
@@ -748,8 +1336,16 @@ void SpritesU::drawBasicNoChecks(
                 count = cols;
                 do
                 {
-                    image_data = pgm_read_byte(image_ptr++);
-                    mask_data = pgm_read_byte(image_ptr++);
+                    if(mode & 8)
+                    {
+                        image_data = pgm_read_byte(image_ptr + plane_offset);
+                        mask_data = pgm_read_byte(image_ptr++);
+                    }
+                    else
+                    {
+                        image_data = pgm_read_byte(image_ptr++);
+                        mask_data = pgm_read_byte(image_ptr++);
+                    }
                     image_data = (uint8_t)image_data * shift_coef;
                     mask_data = (uint8_t)mask_data * shift_coef;
                     buf_data = *buf;
@@ -770,8 +1366,16 @@ void SpritesU::drawBasicNoChecks(
         {
             do
             {
-                image_data = pgm_read_byte(image_ptr++);
-                mask_data = pgm_read_byte(image_ptr++);
+                if(mode & 8)
+                {
+                    image_data = pgm_read_byte(image_ptr + plane_offset);
+                    mask_data = pgm_read_byte(image_ptr++);
+                }
+                else
+                {
+                    image_data = pgm_read_byte(image_ptr++);
+                    mask_data = pgm_read_byte(image_ptr++);
+                }
                 image_data = (uint8_t)image_data * shift_coef;
                 mask_data = (uint8_t)mask_data * shift_coef;
                 buf_data = *buf;
@@ -863,8 +1467,13 @@ void SpritesU::drawBasicNoChecks(
                 out %[spdr], __zero_reg__
                 mul %A[image_data], %[shift_coef]
                 ld %[buf_data], %a[buf]
+                .if %[erase]
+                com r1
+                and %[buf_data], r1
+                .else
                 and %[buf_data], %B[shift_mask]
                 or %[buf_data], r1
+                .endif
                 st %a[buf]+, %[buf_data]
                 lpm
                 rjmp .+0
@@ -932,12 +1541,22 @@ void SpritesU::drawBasicNoChecks(
                 out %[spdr], __zero_reg__
                 mul %A[image_data], %[shift_coef]
                 ld %[buf_data], %a[buf]
+                .if %[erase]
+                com r0
+                and %[buf_data], r0
+                .else
                 and %[buf_data], %A[shift_mask]
                 or %[buf_data], r0
+                .endif
                 st %a[buf]+, %[buf_data]
                 ld %[buf_data], %a[bufn]
+                .if %[erase]
+                com r1
+                and %[buf_data], r1
+                .else
                 and %[buf_data], %B[shift_mask]
                 or %[buf_data], r1
+                .endif
                 st %a[bufn]+, %[buf_data]
                 dec %[count]
                 brne L%=_middle_loop_inner
@@ -1004,8 +1623,13 @@ void SpritesU::drawBasicNoChecks(
                 out %[spdr], __zero_reg__
                 mul %A[image_data], %[shift_coef]
                 ld %[buf_data], %a[buf]
+                .if %[erase]
+                com r0
+                and %[buf_data], r0
+                .else
                 and %[buf_data], %A[shift_mask]
                 or %[buf_data], r0
+                .endif
                 st %a[buf]+, %[buf_data]
                 lpm
                 rjmp .+0
@@ -1061,6 +1685,7 @@ void SpritesU::drawBasicNoChecks(
             [bottom]     "r"   (bottom),
             [page_start] "r"   (page_start),
             [mode]       "r"   (mode),
+            [erase]      "n"   (MODE & 8),
             [sfc_read]   "r"   (sfc_read),
             [fxport]     "I"   (_SFR_IO_ADDR(FX_PORT)),
             [fxbit]      "I"   (FX_BIT),
@@ -1087,8 +1712,13 @@ void SpritesU::drawBasicNoChecks(
                     image_data = FX::readPendingUInt8();
                     image_data = (uint8_t)image_data * shift_coef;
                     buf_data = *buf;
-                    buf_data &= uint8_t(shift_mask >> 8);
-                    buf_data |= uint8_t(image_data >> 8);
+                    if(mode & 8)
+                        buf_data &= ~uint8_t(image_data >> 8);
+                    else
+                    {
+                        buf_data &= uint8_t(shift_mask >> 8);
+                        buf_data |= uint8_t(image_data >> 8);
+                    }
                     *buf++ = buf_data;
                 } while(--count != 0);
             }
@@ -1133,12 +1763,22 @@ void SpritesU::drawBasicNoChecks(
                         image_data = FX::readPendingUInt8();
                         image_data = (uint8_t)image_data * shift_coef;
                         buf_data = *buf;
-                        buf_data &= uint8_t(shift_mask >> 0);
-                        buf_data |= uint8_t(image_data >> 0);
+                        if(mode & 8)
+                            buf_data &= ~uint8_t(image_data >> 0);
+                        else
+                        {
+                            buf_data &= uint8_t(shift_mask >> 0);
+                            buf_data |= uint8_t(image_data >> 0);
+                        }
                         *buf++ = buf_data;
                         buf_data = *bufn;
-                        buf_data &= uint8_t(shift_mask >> 8);
-                        buf_data |= uint8_t(image_data >> 8);
+                        if(mode & 8)
+                            buf_data &= ~uint8_t(image_data >> 8);
+                        else
+                        {
+                            buf_data &= uint8_t(shift_mask >> 8);
+                            buf_data |= uint8_t(image_data >> 8);
+                        }
                         *bufn++ = buf_data;
                     } while(--count != 0);
                 }
@@ -1180,8 +1820,13 @@ void SpritesU::drawBasicNoChecks(
                     image_data = FX::readPendingUInt8();
                     image_data = (uint8_t)image_data * shift_coef;
                     buf_data = *buf;
-                    buf_data &= uint8_t(shift_mask >> 0);
-                    buf_data |= uint8_t(image_data >> 0);
+                    if(mode & 8)
+                        buf_data &= ~uint8_t(image_data >> 0);
+                    else
+                    {
+                        buf_data &= uint8_t(shift_mask >> 0);
+                        buf_data |= uint8_t(image_data >> 0);
+                    }
                     *buf++ = buf_data;
                 } while(--cols != 0);
             }
@@ -1208,6 +1853,73 @@ void SpritesU::drawBasicNoChecks(
     {} // empty final else block, if needed
 }
 
+// kernels called from the header-defined templates in other files
+#ifdef SPRITESU_OVERWRITE
+template void SpritesU::drawBasic<SpritesU::MODE_OVERWRITE>(
+    int16_t, int16_t, uint8_t, uint8_t, uint24_t, uint16_t);
+#endif
+#ifdef SPRITESU_PLUSMASK
+template void SpritesU::drawBasic<SpritesU::MODE_PLUSMASK>(
+    int16_t, int16_t, uint8_t, uint8_t, uint24_t, uint16_t);
+#endif
+#if defined(SPRITESU_OVERWRITE) || defined(SPRITESU_PLUSMASK)
+template void SpritesU::drawBasic<SpritesU::MODE_SELFMASK>(
+    int16_t, int16_t, uint8_t, uint8_t, uint24_t, uint16_t);
+#endif
+
+void SpritesU::drawBasic(
+    int16_t x, int16_t y, uint8_t w, uint8_t h,
+    uint24_t image, uint16_t frame, uint8_t mode)
+{
+#ifdef SPRITESU_OVERWRITE
+    if(mode == MODE_OVERWRITE)
+        drawBasic<MODE_OVERWRITE>(x, y, w, h, image, frame);
+#endif
+#ifdef SPRITESU_PLUSMASK
+    if(mode == MODE_PLUSMASK)
+        drawBasic<MODE_PLUSMASK>(x, y, w, h, image, frame);
+#endif
+#if defined(SPRITESU_OVERWRITE) || defined(SPRITESU_PLUSMASK)
+    if(mode == MODE_SELFMASK)
+        drawBasic<MODE_SELFMASK>(x, y, w, h, image, frame);
+#endif
+#ifdef SPRITESU_FX
+    if(mode == MODE_OVERWRITEFX)
+        drawBasic<MODE_OVERWRITEFX>(x, y, w, h, image, frame);
+    if(mode == MODE_PLUSMASKFX)
+        drawBasic<MODE_PLUSMASKFX>(x, y, w, h, image, frame);
+    if(mode == MODE_SELFMASKFX)
+        drawBasic<MODE_SELFMASKFX>(x, y, w, h, image, frame);
+#endif
+}
+
+void SpritesU::drawBasicNoChecks(
+    uint16_t w_and_h,
+    uint24_t image, uint8_t mode,
+    int16_t x, int16_t y)
+{
+#ifdef SPRITESU_OVERWRITE
+    if(mode == MODE_OVERWRITE)
+        drawBasicNoChecks<MODE_OVERWRITE>(w_and_h, image, x, y);
+#endif
+#ifdef SPRITESU_PLUSMASK
+    if(mode == MODE_PLUSMASK)
+        drawBasicNoChecks<MODE_PLUSMASK>(w_and_h, image, x, y);
+#endif
+#if defined(SPRITESU_OVERWRITE) || defined(SPRITESU_PLUSMASK)
+    if(mode == MODE_SELFMASK)
+        drawBasicNoChecks<MODE_SELFMASK>(w_and_h, image, x, y);
+#endif
+#ifdef SPRITESU_FX
+    if(mode == MODE_OVERWRITEFX)
+        drawBasicNoChecks<MODE_OVERWRITEFX>(w_and_h, image, x, y);
+    if(mode == MODE_PLUSMASKFX)
+        drawBasicNoChecks<MODE_PLUSMASKFX>(w_and_h, image, x, y);
+    if(mode == MODE_SELFMASKFX)
+        drawBasicNoChecks<MODE_SELFMASKFX>(w_and_h, image, x, y);
+#endif
+}
+
 #ifdef SPRITESU_OVERWRITE
 void SpritesU::drawOverwrite(
     int16_t x, int16_t y, uint8_t const* image, uint16_t frame)
@@ -1222,12 +1934,12 @@ void SpritesU::drawOverwrite(
     w = pgm_read_byte(image++);
     h = pgm_read_byte(image++);
 #endif
-    drawBasic(x, y, w, h, (uint24_t)image, frame, MODE_OVERWRITE);
+    drawBasic<MODE_OVERWRITE>(x, y, w, h, (uint24_t)image, frame);
 }
 void SpritesU::drawOverwrite(
     int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t const* image)
 {
-    drawBasic(x, y, w, h, (uint24_t)image, 0, MODE_OVERWRITE);
+    drawBasic<MODE_OVERWRITE>(x, y, w, h, (uint24_t)image, 0);
 }
 #endif
 
@@ -1245,12 +1957,62 @@ void SpritesU::drawPlusMask(
     w = pgm_read_byte(image++);
     h = pgm_read_byte(image++);
 #endif
-    drawBasic(x, y, w, h, (uint24_t)image, frame, MODE_PLUSMASK);
+    drawBasic<MODE_PLUSMASK>(x, y, w, h, (uint24_t)image, frame);
 }
 void SpritesU::drawPlusMask(
     int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t const* image)
 {
-    drawBasic(x, y, w, h, (uint24_t)image, 0, MODE_PLUSMASK);
+    drawBasic<MODE_PLUSMASK>(x, y, w, h, (uint24_t)image, 0);
+}
+void SpritesU::drawPreShifted(
+    int16_t x, int16_t y, uint8_t const* image, uint16_t frame)
+{
+    uint8_t w, h;
+#ifdef ARDUINO_ARCH_AVR
+    asm volatile(
+        "lpm %[w], Z+\n"
+        "lpm %[h], Z+\n"
+        : [w] "=r" (w), [h] "=r" (h), [image] "+z" (image));
+#else
+    w = pgm_read_byte(image++);
+    h = pgm_read_byte(image++);
+#endif
+    // each copy is h + 8 rows; copy 0 is drawn without its empty last page
+    uint8_t shift = uint8_t(y) & 7;
+    uint16_t copy = uint16_t((h >> 3) + 1) * w * 2;
+    image += (frame * 8 + shift) * copy;
+    if(shift != 0) h += 8;
+    drawBasic<MODE_PLUSMASK>(x, y - shift, w, h, (uint24_t)image, 0);
+}
+void SpritesU::drawPlusMaskShared(
+    int16_t x, int16_t y, uint8_t const* image, uint16_t frame,
+    uint8_t planes, uint8_t plane)
+{
+    uint8_t w, h;
+#ifdef ARDUINO_ARCH_AVR
+    asm volatile(
+        "lpm %[w], Z+\n"
+        "lpm %[h], Z+\n"
+        : [w] "=r" (w), [h] "=r" (h), [image] "+z" (image));
+#else
+    w = pgm_read_byte(image++);
+    h = pgm_read_byte(image++);
+#endif
+    {
+    int16_t by = y - SPRITESU_BAND_Y;
+    if(x >= 128) return;
+    if(by >= SPRITESU_HEIGHT) return;
+    if(x + w <= 0) return;
+    if(by + h <= 0) return;
+    }
+
+    // the mask leads each frame and the plane's image bytes follow it at
+    // a fixed offset, so the plus-mask kernel walks the mask
+    uint16_t plane_bytes = uint16_t(h >> 3) * w;
+    image += uint16_t(frame) * (planes + 1) * plane_bytes;
+    drawBasicNoChecks<MODE_PLUSMASKSHARED>(
+        (uint16_t(h) << 8) | w, (uint24_t)image, x, y,
+        uint16_t(plane + 1) * plane_bytes);
 }
 #endif
 
@@ -1268,12 +2030,12 @@ void SpritesU::drawSelfMask(
     w = pgm_read_byte(image++);
     h = pgm_read_byte(image++);
 #endif
-    drawBasic(x, y, w, h, (uint24_t)image, frame, MODE_SELFMASK);
+    drawBasic<MODE_SELFMASK>(x, y, w, h, (uint24_t)image, frame);
 }
 void SpritesU::drawSelfMask(
     int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t const* image)
 {
-    drawBasic(x, y, w, h, (uint24_t)image, 0, MODE_SELFMASK);
+    drawBasic<MODE_SELFMASK>(x, y, w, h, (uint24_t)image, 0);
 }
 #endif
 
@@ -1284,12 +2046,12 @@ void SpritesU::drawOverwriteFX(
     FX::seekData(image);
     uint8_t w = FX::readPendingUInt8();
     uint8_t h = FX::readEnd();
-    drawBasic(x, y, w, h, image + 2, frame, MODE_OVERWRITEFX);
+    drawBasic<MODE_OVERWRITEFX>(x, y, w, h, image + 2, frame);
 }
 void SpritesU::drawOverwriteFX(
     int16_t x, int16_t y, uint8_t w, uint8_t h, uint24_t image, uint16_t frame)
 {
-    drawBasic(x, y, w, h, image + 2, frame, MODE_OVERWRITEFX);
+    drawBasic<MODE_OVERWRITEFX>(x, y, w, h, image + 2, frame);
 }
 void SpritesU::drawPlusMaskFX(
     int16_t x, int16_t y, uint24_t image, uint16_t frame)
@@ -1297,12 +2059,12 @@ void SpritesU::drawPlusMaskFX(
     FX::seekData(image);
     uint8_t w = FX::readPendingUInt8();
     uint8_t h = FX::readEnd();
-    drawBasic(x, y, w, h, image + 2, frame, MODE_PLUSMASKFX);
+    drawBasic<MODE_PLUSMASKFX>(x, y, w, h, image + 2, frame);
 }
 void SpritesU::drawPlusMaskFX(
     int16_t x, int16_t y, uint8_t w, uint8_t h, uint24_t image, uint16_t frame)
 {
-    drawBasic(x, y, w, h, image + 2, frame, MODE_PLUSMASKFX);
+    drawBasic<MODE_PLUSMASKFX>(x, y, w, h, image + 2, frame);
 }
 void SpritesU::drawSelfMaskFX(
     int16_t x, int16_t y, uint24_t image, uint16_t frame)
@@ -1310,12 +2072,24 @@ void SpritesU::drawSelfMaskFX(
     FX::seekData(image);
     uint8_t w = FX::readPendingUInt8();
     uint8_t h = FX::readEnd();
-    drawBasic(x, y, w, h, image + 2, frame, MODE_SELFMASKFX);
+    drawBasic<MODE_SELFMASKFX>(x, y, w, h, image + 2, frame);
 }
 void SpritesU::drawSelfMaskFX(
     int16_t x, int16_t y, uint8_t w, uint8_t h, uint24_t image, uint16_t frame)
 {
-    drawBasic(x, y, w, h, image + 2, frame, MODE_SELFMASKFX);
+    drawBasic<MODE_SELFMASKFX>(x, y, w, h, image + 2, frame);
+}
+void SpritesU::drawPlusMaskSharedFX(
+    int16_t x, int16_t y, uint24_t image, uint16_t frame,
+    uint8_t planes, uint8_t plane)
+{
+    FX::seekData(image);
+    uint8_t w = FX::readPendingUInt8();
+    uint8_t h = FX::readEnd();
+    uint16_t plane_bytes = uint16_t(h >> 3) * w;
+    image += 2 + uint24_t(frame) * (planes + 1) * plane_bytes;
+    drawBasic<MODE_ERASEFX>(x, y, w, h, image, 0);
+    drawBasic<MODE_SELFMASKFX>(x, y, w, h, image + uint24_t(plane + 1) * plane_bytes, 0);
 }
 #endif
 
@@ -1355,7 +2129,18 @@ static __attribute__((always_inline)) uint8_t SpritesU_bitShiftLeftMaskUInt8(uin
 void SpritesU::fillRect_i8(int8_t x, int8_t y, uint8_t w, uint8_t h, uint8_t color)
 {
     if(w == 0 || h == 0) return;
-    if(y >= 64)  return;
+#if defined(SPRITESU_BAND)
+    {
+        // move to band coordinates, clipping the top here so y fits int8_t
+        int16_t by = y - SPRITESU_BAND_Y;
+        if(by >= SPRITESU_HEIGHT) return;
+        if(by + h <= 0) return;
+        if(by < 0)
+            h += by, by = 0;
+        y = int8_t(by);
+    }
+#endif
+    if(y >= SPRITESU_HEIGHT) return;
     if(x + w <= 0) return;
     if(y + h <= 0) return;
 
@@ -1372,8 +2157,8 @@ void SpritesU::fillRect_i8(int8_t x, int8_t y, uint8_t w, uint8_t h, uint8_t col
         h += y, yc = 0;
     if(x < 0)
         w += x, xc = 0;
-    if(h >= uint8_t(64 - yc))
-        h = 64 - yc;
+    if(h >= uint8_t(SPRITESU_HEIGHT - yc))
+        h = SPRITESU_HEIGHT - yc;
     if(w >= uint8_t(128 - xc))
         w = 128 - xc;
     uint8_t y1 = yc + h;
@@ -1400,7 +2185,7 @@ void SpritesU::fillRect_i8(int8_t x, int8_t y, uint8_t w, uint8_t h, uint8_t col
     r1 >>= 3;
 #endif
 
-    uint8_t* buf = Arduboy2Base::sBuffer;
+    uint8_t* buf = SPRITESU_BUFFER;
 #ifdef ARDUINO_ARCH_AVR
     asm volatile(
         "mul %[r0], %[c128]\n"
@@ -1554,4 +2339,131 @@ void SpritesU::fillRect_i8(int8_t x, int8_t y, uint8_t w, uint8_t h, uint8_t col
 }
 #endif
 
+#ifdef SPRITESU_TILEMAP
+void SpritesU::drawTilemap(
+    int16_t x, int16_t y,
+    uint8_t const* tilemap, uint8_t map_w, uint8_t map_h,
+    uint8_t const* tileset, uint8_t planes, uint8_t plane)
+{
+    uint8_t tw = pgm_read_byte(tileset++);
+    uint8_t th = pgm_read_byte(tileset++);
+    uint8_t tpages = th >> 3;
+    uint16_t tile_bytes = uint16_t(tpages) * tw;
+    uint16_t tile_stride = tile_bytes * planes;
+    tileset += tile_bytes * plane;
+
+    y -= SPRITESU_BAND_Y;
+    if(x >= 128) return;
+    if(y >= SPRITESU_HEIGHT) return;
+    if(x + int16_t(uint16_t(map_w) * tw) <= 0) return;
+    if(y + int16_t(uint16_t(map_h) * th) <= 0) return;
+
+    // clip against left edge: find first visible tile column
+    uint8_t col_start = uint8_t(x);
+    uint8_t tile_col = 0;
+    uint8_t tile_x = 0;
+    if(x < 0)
+    {
+        uint16_t u = uint16_t(-x);
+        tile_col = uint8_t(u / tw);
+        tile_x = uint8_t(u - uint16_t(tile_col) * tw);
+        col_start = 0;
+    }
+
+    // clip against right edge
+    uint8_t cols = 128 - col_start;
+    {
+        uint16_t rem = uint16_t(map_w - tile_col) * tw - tile_x;
+        if(rem < cols) cols = uint8_t(rem);
+    }
+
+    // precompute vertical shift coef and mask once for the whole map
+    uint8_t shift_coef = SpritesU_bitShiftLeftUInt8(uint8_t(y));
+    uint16_t shift_mask = ~(0xff * shift_coef);
+
+    // clip against top edge: aligned maps never write the page above
+    int16_t page = y >> 3;
+    int8_t page_min = (shift_coef == 1) ? 0 : -1;
+    uint16_t src_page = 0;
+    if(page < page_min)
+    {
+        src_page = uint16_t(page_min - page);
+        page = page_min;
+    }
+    uint16_t src_pages = uint16_t(map_h) * tpages;
+    if(src_page >= src_pages) return;
+    src_pages -= src_page;
+    uint8_t tile_row  = uint8_t(src_page / tpages);
+    uint8_t tile_page = uint8_t(src_page - uint16_t(tile_row) * tpages);
+
+    uint8_t* buf = SPRITESU_BUFFER + col_start + page * 128;
+    uint8_t const* map_row = tilemap + uint16_t(tile_row) * map_w + tile_col;
+
+    for(int8_t p = int8_t(page); p < SPRITESU_HEIGHT / 8 && src_pages != 0; ++p, --src_pages)
+    {
+        // clip against top and bottom edges once per row of pages:
+        // bit 0: write to buf, bit 1: write to buf+128
+        uint8_t dst = 0;
+        if(p >= 0) dst |= 1;
+        if(p < SPRITESU_HEIGHT / 8 - 1 && shift_coef != 1) dst |= 2;
+
+        uint8_t* b = buf;
+        uint8_t const* m = map_row;
+        uint8_t const* page_base = tileset + uint16_t(tile_page) * tw;
+        uint8_t tx = tile_x;
+        uint8_t n = cols;
+        do
+        {
+            uint8_t tile = pgm_read_byte(m++);
+            uint8_t const* image_ptr = page_base + tile * tile_stride + tx;
+            uint8_t count = tw - tx;
+            if(count > n) count = n;
+            n -= count;
+            tx = 0;
+            if(shift_coef == 1)
+            {
+                do *b++ = pgm_read_byte(image_ptr++);
+                while(--count != 0);
+            }
+            else if(dst == 3)
+            {
+                do
+                {
+                    uint16_t t = pgm_read_byte(image_ptr++) * shift_coef;
+                    b[0]   = (b[0]   & uint8_t(shift_mask >> 0)) | uint8_t(t >> 0);
+                    b[128] = (b[128] & uint8_t(shift_mask >> 8)) | uint8_t(t >> 8);
+                    ++b;
+                } while(--count != 0);
+            }
+            else if(dst == 1)
+            {
+                do
+                {
+                    uint16_t t = pgm_read_byte(image_ptr++) * shift_coef;
+                    b[0]   = (b[0]   & uint8_t(shift_mask >> 0)) | uint8_t(t >> 0);
+                    ++b;
+                } while(--count != 0);
+            }
+            else
+            {
+                do
+                {
+                    uint16_t t = pgm_read_byte(image_ptr++) * shift_coef;
+                    b[128] = (b[128] & uint8_t(shift_mask >> 8)) | uint8_t(t >> 8);
+                    ++b;
+                } while(--count != 0);
+            }
+        } while(n != 0);
+
+        // advance buf and map to the next page
+        buf += 128;
+        if(++tile_page >= tpages)
+        {
+            tile_page = 0;
+            map_row += map_w;
+        }
+    }
+}
+#endif
+
 #endif
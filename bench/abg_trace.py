@@ -0,0 +1,191 @@
+'''
+Decode an ArduboyG trace dump into Chrome trace JSON.
+
+Build with ABG_TRACE and call traceDump(Serial) (for example on a button
+press) to print the trace ring. Save the serial output to a file and
+convert it with this script; the JSON opens in chrome://tracing or
+https://ui.perfetto.dev. Lines outside the dump are ignored, and the last
+dump in the input is used.
+
+The timeline has two tracks:
+    ISR     instant events for each frame ISR (phase or L8_Binary event)
+    main    waitForNextPlane() wakeups, doDisplay() and paint spans, and
+            user spans from traceBegin()/traceEnd()
+
+Times are unwrapped from 16-bit timer ticks, so consecutive entries must
+be less than one wrap apart (262 ms with the default timer prescaler),
+which holds while the frame ISR is running.
+
+With --summary, the longest instances of each span and the ISR periods
+that passed without a doDisplay() are printed instead, which is where a
+slow plane shows up. Every frame ISR requests a doDisplay(), including
+each of the three ABG_SYNC_THREE_PHASE phases, so any such period is a
+missed one. The exception is L8_Binary, where only the display events
+(ISR event 0, 2 or 5) request one, so its hold and park ISRs are counted
+as missed periods too.
+
+Examples:
+
+    python3 bench/abg_trace.py serial.log -o trace.json
+    python3 bench/abg_trace.py serial.log --summary
+'''
+
+import argparse
+import json
+import sys
+
+# entry kinds, as abg_detail::trace_* in ArduboyG.h
+TRACE_ISR     = 1
+TRACE_WAKE    = 2
+TRACE_DISPLAY = 3
+TRACE_PAINT   = 4
+TRACE_USER    = 5
+TRACE_END     = 0x80
+
+TID_ISR  = 0
+TID_MAIN = 1
+
+def parse(lines):
+    '''Return (tick_us, [(time, kind, arg)]) for the last dump in lines'''
+    dump = None
+    entries = None
+    for line in lines:
+        f = line.split()
+        if len(f) == 2 and f[0] == 'ABG_TRACE':
+            entries = []
+            tick_us = int(f[1])
+        elif f == ['ABG_TRACE_END'] and entries is not None:
+            dump = (tick_us, entries)
+            entries = None
+        elif entries is not None and len(f) == 3:
+            try:
+                entries.append(tuple(int(x) for x in f))
+            except ValueError:
+                pass
+    if dump is None:
+        raise SystemExit('no ABG_TRACE dump found')
+    return dump
+
+def unwrap(entries, tick_us):
+    '''Return [(us, kind, arg)] with times unwrapped from 16 bits and
+    counted from the oldest entry'''
+    out = []
+    base = 0
+    last = None
+    for time, kind, arg in entries:
+        if last is None:
+            base = -time
+        elif time < last:
+            base += 0x10000
+        last = time
+        out.append(((base + time) * tick_us, kind, arg))
+    return out
+
+def span_name(kind, arg):
+    if kind == TRACE_DISPLAY:
+        return 'doDisplay'
+    if kind == TRACE_PAINT:
+        return 'paint'
+    if kind == TRACE_USER:
+        return 'user %d' % arg
+    return 'kind %d' % kind
+
+def spans(events):
+    '''Yield (name, begin, end, begin_arg, end_arg) for each complete
+    span; spans cut off by the start of the ring are skipped'''
+    open_spans = {}
+    for t, kind, arg in events:
+        k = kind & ~TRACE_END
+        if k in (TRACE_ISR, TRACE_WAKE):
+            continue
+        # user spans are matched by id, others by kind
+        key = (k, arg) if k == TRACE_USER else k
+        if kind & TRACE_END:
+            if key in open_spans:
+                t0, arg0 = open_spans.pop(key)
+                yield (span_name(k, arg), t0, t, arg0, arg)
+        else:
+            open_spans[key] = (t, arg)
+
+def chrome_trace(events):
+    out = [
+        dict(ph = 'M', pid = 0, tid = TID_ISR, name = 'thread_name',
+            args = dict(name = 'ISR')),
+        dict(ph = 'M', pid = 0, tid = TID_MAIN, name = 'thread_name',
+            args = dict(name = 'main')),
+    ]
+    for t, kind, arg in events:
+        if kind == TRACE_ISR:
+            out.append(dict(ph = 'i', s = 't', pid = 0, tid = TID_ISR,
+                ts = t, name = 'ISR', args = dict(event = arg)))
+        elif kind == TRACE_WAKE:
+            out.append(dict(ph = 'i', s = 't', pid = 0, tid = TID_MAIN,
+                ts = t, name = 'wake'))
+    for name, t0, t1, arg0, arg1 in spans(events):
+        args = {}
+        if name == 'doDisplay':
+            args = dict(plane = arg0, next_plane = arg1)
+        elif name == 'paint':
+            args = dict(page = arg0 & 15, pages = arg0 >> 4)
+        out.append(dict(ph = 'X', pid = 0, tid = TID_MAIN, ts = t0,
+            dur = t1 - t0, name = name, args = args))
+    return dict(traceEvents = out, displayTimeUnit = 'ms')
+
+def summary(events, top):
+    by_name = {}
+    for name, t0, t1, arg0, arg1 in spans(events):
+        by_name.setdefault(name, []).append((t1 - t0, t0))
+    for name in sorted(by_name):
+        d = by_name[name]
+        total = sum(x[0] for x in d)
+        print('%-10s %5d spans, avg %6d us, max %6d us' %
+            (name, len(d), total // len(d), max(d)[0]))
+        for dur, t0 in sorted(d, reverse = True)[:top]:
+            print('    %6d us at %d us' % (dur, t0))
+    # frame ISRs with no doDisplay() before the next one mean render()
+    # overran, which shows as a repeated plane
+    missed = []
+    isr = None
+    displayed = True
+    for t, kind, arg in events:
+        if kind == TRACE_ISR:
+            if not displayed:
+                missed.append(isr)
+            isr = t
+            displayed = False
+        elif kind == TRACE_DISPLAY:
+            displayed = True
+    print('%d ISR periods without a doDisplay()' % len(missed))
+    for t in missed[:top]:
+        print('    ISR at %d us' % t)
+
+def main():
+    ap = argparse.ArgumentParser(description = __doc__,
+        formatter_class = argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('input', nargs = '?', help = 'serial log (default stdin)')
+    ap.add_argument('-o', '--output', help = 'JSON file (default stdout)')
+    ap.add_argument('--summary', action = 'store_true',
+        help = 'print the slowest spans and missed ISR periods')
+    ap.add_argument('--top', type = int, default = 5,
+        help = 'instances listed per span with --summary')
+    args = ap.parse_args()
+
+    if args.input:
+        with open(args.input) as f:
+            tick_us, entries = parse(f)
+    else:
+        tick_us, entries = parse(sys.stdin)
+    events = unwrap(entries, tick_us)
+
+    if args.summary:
+        summary(events, args.top)
+        return
+    trace = chrome_trace(events)
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+if __name__ == '__main__':
+    main()
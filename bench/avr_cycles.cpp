@@ -0,0 +1,343 @@
+/*
+Cycle-exact profiling of the SpritesU and ArduboyG paint AVR kernels
+under simavr.
+
+Build for the ATmega32u4 and run with no hardware attached (the simavr
+headers provide avr_mcu_section.h, and bench/host the Arduboy2
+declarations that ArduboyG.h needs):
+
+    avr-g++ -mmcu=atmega32u4 -DF_CPU=16000000UL -DARDUINO_ARCH_AVR -Os \
+        -I/usr/include/simavr -Ibench/host -o avr_cycles.elf bench/avr_cycles.cpp
+    simavr -m atmega32u4 -f 16000000 avr_cycles.elf
+
+Each kernel call is timed with TIMER1 running at the CPU clock, with
+the cost of an empty call subtracted. Output goes to the simavr console
+through GPIOR0. The same ELF also runs on a device, where the numbers
+are identical but the console output is not visible.
+
+The SSD1306 paint() kernels are timed the same way, clearing, not
+clearing and clearing to a pattern (ABG_CLEAR_PATTERN). The plane budget
+table adds up the measured paints that doDisplay() makes in one plane
+for each ABG_SYNC_* method (1024 bytes for park row, 1152 for slow drive
+and 1280 for three phase, as bench/display_host.cpp checks) and reports
+the cycles left for render() in the plane period, which uses the same
+timer_counter formula as ArduboyG.h. Command bytes are not counted.
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <avr/avr_mcu_section.h>
+
+AVR_MCU(F_CPU, "atmega32u4");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#include <Arduboy2.h>
+
+uint8_t Arduboy2Base::sBuffer[1024];
+
+#define SPRITESU_IMPLEMENTATION
+#define SPRITESU_OVERWRITE
+#define SPRITESU_PLUSMASK
+#define SPRITESU_RECT
+#define SPRITESU_TILEMAP
+#include "../SpritesU.hpp"
+
+#define ABG_CLEAR_PATTERN
+#include "../ArduboyG.h"
+
+using Display = abg_detail::Display;
+
+#if !defined(ABG_REFRESH_HZ)
+#define ABG_REFRESH_HZ 156
+#endif
+
+// enough for a 32x32 plus-mask sprite with 2 frames
+static uint8_t const IMAGE[2 + 32 * 4 * 2 * 2] PROGMEM = { 32, 32 };
+static uint8_t const TILES[2 + 16 * 2 * 4] PROGMEM = { 16, 16 };
+static uint8_t const TILEMAP[16 * 8] PROGMEM = {};
+// one 16x16 frame in the pre-shifted format of convert_sprite.py
+static uint8_t const PRESHIFTED[2 + 8 * 3 * 16 * 2] PROGMEM = { 16, 16 };
+// one 16x16 frame of 3 planes in the shared-mask format
+static uint8_t const SHARED[2 + 4 * 16 * 2] PROGMEM = { 16, 16 };
+
+static void put(char c)
+{
+    GPIOR0 = c;
+}
+
+static void print(char const* s)
+{
+    while(*s) put(*s++);
+}
+
+static void print(uint32_t n, uint8_t width = 0)
+{
+    char t[11];
+    uint8_t i = 0;
+    do t[i++] = char('0' + n % 10);
+    while((n /= 10) != 0);
+    while(width > i) put(' '), --width;
+    while(i != 0) put(t[--i]);
+}
+
+enum Method : uint8_t
+{
+    OVERWRITE,
+    PLUSMASK,
+    SELFMASK,
+    FILLRECT,
+};
+
+static char const* const METHOD_NAMES[] =
+{
+    "drawOverwrite ",
+    "drawPlusMask  ",
+    "drawSelfMask  ",
+    "fillRect_i8   ",
+};
+
+static char const* const CLIP_NAMES[] =
+{
+    "inside ",
+    "left   ",
+    "top    ",
+    "right  ",
+    "bottom ",
+};
+
+// the draw under test; noinline so every call has the same overhead
+__attribute__((noinline))
+static void draw(Method m, int16_t x, int16_t y, uint8_t w, uint8_t h)
+{
+    uint8_t const* image = IMAGE;
+    switch(m)
+    {
+    case OVERWRITE: SpritesU::drawOverwrite(x, y, w, h, image + 2); break;
+    case PLUSMASK:  SpritesU::drawPlusMask(x, y, w, h, image + 2);  break;
+    case SELFMASK:  SpritesU::drawSelfMask(x, y, w, h, image + 2);  break;
+    case FILLRECT:  SpritesU::fillRect_i8(int8_t(x), int8_t(y), w, h, 1); break;
+    }
+}
+
+__attribute__((noinline))
+static void draw_nothing(Method, int16_t, int16_t, uint8_t, uint8_t)
+{
+    asm volatile("");
+}
+
+template<class F>
+static uint16_t cycles(F f)
+{
+    cli();
+    TCNT1 = 0;
+    f();
+    uint16_t t = TCNT1;
+    sei();
+    return t;
+}
+
+// buffer bytes touched by a draw of w x h at (x, y), after clipping
+static uint16_t bytes_written(int16_t x, int16_t y, uint8_t w, uint8_t h)
+{
+    int16_t x0 = x < 0 ? 0 : x;
+    int16_t x1 = x + w > 128 ? 128 : x + w;
+    int16_t y0 = y < 0 ? 0 : y;
+    int16_t y1 = y + h > 64 ? 64 : y + h;
+    if(x1 <= x0 || y1 <= y0) return 0;
+    return uint16_t(x1 - x0) * uint16_t((y1 - 1) / 8 - y0 / 8 + 1);
+}
+
+static void profile_kernels()
+{
+    static uint8_t const SIZES[] = { 8, 16, 32 };
+    static uint8_t const YOFFS[] = { 0, 1, 4, 7 };
+
+    uint16_t overhead = cycles([] { draw_nothing(OVERWRITE, 0, 0, 8, 8); });
+
+    print("kernel         size   clip    y&7  cycles  cyc/byte\n");
+    for(uint8_t m = OVERWRITE; m <= FILLRECT; ++m)
+    for(uint8_t size : SIZES)
+    for(uint8_t c = 0; c < 5; ++c)
+    for(uint8_t yoff : YOFFS)
+    {
+        int16_t half = size / 2;
+        int16_t x = c == 1 ? -half : c == 3 ? 128 - half : 48;
+        int16_t y = c == 2 ? -half : c == 4 ?  64 - half : 16;
+        y = int16_t((y & ~7) + yoff);
+        uint16_t bytes = bytes_written(x, y, size, size);
+        if(bytes == 0) continue;
+
+        uint16_t t = cycles([&] { draw(Method(m), x, y, size, size); }) - overhead;
+
+        print(METHOD_NAMES[m]);
+        print(size, 2); put('x'); print(size); print(size < 10 ? "    " : "   ");
+        print(CLIP_NAMES[c]);
+        print(yoff, 3);
+        print(t, 8);
+        print(t / bytes, 10);
+        put('.'); print((t % bytes) * 10 / bytes);
+        put('\n');
+    }
+
+    uint16_t t = cycles([] {
+        SpritesU::drawTilemap(-3, -5, TILEMAP, 16, 8, TILES, 1, 0);
+    });
+    print("drawTilemap 16x16 tiles, full screen, unaligned: ");
+    print(t); print(" cycles\n");
+    t = cycles([] {
+        SpritesU::drawTilemap(-3, -8, TILEMAP, 16, 8, TILES, 1, 0);
+    });
+    print("drawTilemap 16x16 tiles, full screen, aligned:   ");
+    print(t); print(" cycles\n");
+
+    // size-specialised kernels against the generic path, on screen
+    print("\nunrolled       size   y&7  generic  unrolled\n");
+    for(uint8_t yoff : YOFFS)
+    {
+        int16_t y = 16 + yoff;
+        uint16_t g8  = cycles([&] { SpritesU::drawOverwrite(48, y, 8, 8, TILES + 2); });
+        uint16_t u8  = cycles([&] { SpritesU::drawOverwrite<8, 8>(48, y, TILES, 0); });
+        uint16_t g16 = cycles([&] { SpritesU::drawOverwrite(48, y, 16, 16, TILES + 2); });
+        uint16_t u16 = cycles([&] { SpritesU::drawOverwrite<16, 16>(48, y, TILES, 0); });
+        print("drawOverwrite   8x8 "); print(yoff, 5); print(g8, 9); print(u8, 10); put('\n');
+        print("drawOverwrite 16x16 "); print(yoff, 5); print(g16, 9); print(u16, 10); put('\n');
+    }
+
+    // pre-shifted copies against the plus-mask kernel they replace
+    print("\npre-shifted    size   y&7  plusmask  preshifted\n");
+    for(uint8_t yoff : YOFFS)
+    {
+        int16_t y = 16 + yoff;
+        uint16_t pm = cycles([&] { SpritesU::drawPlusMask(48, y, 16, 16, IMAGE + 2); });
+        uint16_t ps = cycles([&] { SpritesU::drawPreShifted(48, y, PRESHIFTED, 0); });
+        print("drawPlusMask  16x16 "); print(yoff, 5); print(pm, 10); print(ps, 12); put('\n');
+    }
+
+    // the shared-mask kernel against the plus-mask kernel, per plane:
+    // this is the cost of storing one mask for all planes
+    print("\nshared mask    size   y&7  plusmask  shared\n");
+    for(uint8_t yoff : YOFFS)
+    {
+        int16_t y = 16 + yoff;
+        uint16_t pm = cycles([&] { SpritesU::drawPlusMask(48, y, 16, 16, IMAGE + 2); });
+        uint16_t sm = cycles([&] { SpritesU::drawPlusMaskShared(48, y, SHARED, 0, 3, 1); });
+        print("drawPlusMask  16x16 "); print(yoff, 5); print(pm, 10); print(sm, 8); put('\n');
+    }
+}
+
+enum PaintKind : uint8_t
+{
+    PAINT_CLEAR,
+    PAINT_NO_CLEAR,
+    PAINT_PATTERN,
+};
+
+static char const* const PAINT_NAMES[] =
+{
+    "paint clear   ",
+    "paint no-clear",
+    "paintPattern  ",
+};
+
+static uint8_t ROW[8];
+
+// the paint under test, as doDisplay() calls it for pages [0, pages)
+__attribute__((noinline))
+static void paint(PaintKind k, uint8_t pages)
+{
+    uint8_t* b = Arduboy2Base::sBuffer;
+    switch(k)
+    {
+    case PAINT_CLEAR:    Display::paint(b, 0x0001, pages, 0xff); break;
+    case PAINT_NO_CLEAR: Display::paint(b, 0x0000, pages, 0xff); break;
+    case PAINT_PATTERN:  Display::paintPattern(b, ROW, pages, 0xff); break;
+    }
+}
+
+__attribute__((noinline))
+static void paint_nothing(PaintKind, uint8_t)
+{
+    asm volatile("");
+}
+
+// measured cycles of one paint of 1 and of 7 pages, per PaintKind
+static uint16_t paint1[3];
+static uint16_t paint7[3];
+
+static void profile_paint()
+{
+    static uint8_t const PAGES[] = { 1, 7 };
+
+    uint16_t overhead = cycles([] { paint_nothing(PAINT_CLEAR, 1); });
+
+    print("\nkernel          pages  cycles  cyc/byte\n");
+    for(uint8_t k = PAINT_CLEAR; k <= PAINT_PATTERN; ++k)
+    for(uint8_t pages : PAGES)
+    {
+        uint16_t t = cycles([&] { paint(PaintKind(k), pages); }) - overhead;
+        (pages == 1 ? paint1 : paint7)[k] = t;
+
+        uint16_t bytes = pages * 128;
+        print(PAINT_NAMES[k]);
+        print(pages, 7);
+        print(t, 8);
+        print(t / bytes, 8);
+        put('.'); print((t % bytes) * 10 / bytes);
+        put('\n');
+    }
+}
+
+static void print_budget(char const* name, uint32_t period, uint16_t bytes,
+    uint32_t paint, uint32_t paint_pattern)
+{
+    print(name);
+    print(period, 12); print(bytes, 7);
+    print(paint, 8); print(period - paint, 8);
+    print(paint_pattern, 9); print(period - paint_pattern, 8);
+    put('\n');
+}
+
+// cycles left for render() in each plane period, per ABG_SYNC_* method,
+// from the paint() timings of profile_paint()
+static void plane_budget()
+{
+    constexpr uint32_t timer_counter = F_CPU / 64 / ABG_REFRESH_HZ;
+    constexpr uint32_t period = timer_counter * 64;
+    constexpr uint32_t short_period = ((timer_counter >> 4) + 1) * 64;
+
+    print("\nABG_REFRESH_HZ "); print(ABG_REFRESH_HZ);
+    print(", timer_counter "); print(timer_counter); put('\n');
+    print("                              -- clear --     -- pattern --\n");
+    print("sync method       period  bytes   paint    left    paint    left\n");
+
+    // the clearing paints of a plane, with and without ABG_CLEAR_PATTERN
+    uint32_t c  = uint32_t(paint7[PAINT_CLEAR])   + paint1[PAINT_CLEAR];
+    uint32_t cp = uint32_t(paint7[PAINT_PATTERN]) + paint1[PAINT_PATTERN];
+    uint32_t n  = paint1[PAINT_NO_CLEAR];
+
+    // page 7 masked to the park row, then pages 0-6
+    print_budget("PARK_ROW    ", period, 1024, c, cp);
+    // page 7 without clearing, pages 0-6, then page 7 blanked
+    print_budget("SLOW_DRIVE  ", period, 1152, c + n, cp + n);
+    // page 7 without clearing in phases 2 and 3, then as slow drive
+    print_budget("THREE_PHASE ", period + short_period * 2, 1280, c + n * 2, cp + n * 2);
+}
+
+int main()
+{
+    // TIMER1 free-running at the CPU clock
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+
+    profile_kernels();
+    profile_paint();
+    plane_budget();
+
+    // simavr exits when the core sleeps with interrupts disabled
+    sleep_enable();
+    cli();
+    sleep_cpu();
+    for(;;);
+}
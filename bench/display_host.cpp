@@ -0,0 +1,138 @@
+/*
+Host check of the ArduboyG paint path through Display_Host.
+
+Build and run from the repository root for each sync method (ArduboyG.h
+relies on -fpermissive, which Arduino builds always pass):
+
+    g++ -O2 -fpermissive -Ibench/host -DABG_SYNC_PARK_ROW \
+        -o display_host bench/display_host.cpp
+    ./display_host
+
+Each plane fills the buffer with a pattern and calls waitForNextPlane(),
+whose wait runs the frame ISR on a host. The bytes Display_Host captured
+must match the stream doDisplay() is meant to send for the sync method,
+built here from the buffer, and the buffer must be left cleared to the
+color of the next plane. ABG_VIEWPORT_PAGES builds are checked too, and
+ABG_OVERLAY builds composite an overlay over the park row and the pages
+above it, read from RAM and from PROGMEM on alternate planes;
+ABG_BANDS cannot run here, as its bottom band waits on a timer count
+that does not advance on a host. The run also prints the bytes painted per
+plane, as used by the plane budget of bench/avr_cycles.cpp, and exits
+with a nonzero status on a mismatch.
+*/
+
+#if defined(ABG_BANDS)
+#error "ABG_BANDS waits on the timer count, which a host does not advance"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#define ABG_IMPLEMENTATION
+#include "../ArduboyG.h"
+
+uint8_t Arduboy2Base::sBuffer[1024];
+
+using Display = abg_detail::Display_Host;
+
+// first buffer byte that is painted and cleared
+#if defined(ABG_VIEWPORT_PAGES)
+constexpr uint16_t FIRST = 128 * (8 - ABG_VIEWPORT_PAGES);
+#else
+constexpr uint16_t FIRST = 0;
+#endif
+
+ArduboyGBase a;
+
+#if defined(ABG_OVERLAY)
+// 10 columns by 3 pages at column 5, page 5, for 3 planes
+constexpr uint8_t OVL_X = 5, OVL_PAGE = 5, OVL_W = 10, OVL_PAGES = 3;
+// on hosts PROGMEM data is ordinary memory, so one table serves both
+static uint8_t overlay[3][OVL_W * OVL_PAGES * 2];
+
+// composites the overlay frame for plane into buf as paint() sends it
+static void composite(uint8_t* buf, uint8_t plane)
+{
+    for(uint8_t p = 0; p < OVL_PAGES; ++p)
+    for(uint8_t c = 0; c < OVL_W; ++c)
+    {
+        uint8_t d = overlay[plane][(p * OVL_W + c) * 2 + 0];
+        uint8_t m = overlay[plane][(p * OVL_W + c) * 2 + 1];
+        uint8_t& t = buf[(OVL_PAGE + p) * 128 + OVL_X + c];
+        t = (t & ~m) | d;
+    }
+}
+#endif
+
+static uint8_t  expected[2048];
+static uint16_t expected_count;
+
+// appends pages [first, first + n) of buf as paint() sends them
+static void expect(uint8_t const* buf, uint8_t first, uint8_t n, uint8_t mask)
+{
+    for(uint16_t i = uint16_t(first + n) * 128; i-- != uint16_t(first) * 128;)
+        expected[expected_count++] = buf[i] & mask;
+}
+
+// the stream doDisplay() sends for one plane, from the buffer it starts with
+static void expect_plane(uint8_t const* buf)
+{
+    expected_count = 0;
+#if defined(ABG_SYNC_THREE_PHASE)
+    expect(buf, 7, 1, 0xf0); // phase 2
+    expect(buf, 7, 1, 0xff); // phase 3
+    expect(buf, 0, 7, 0xff);
+    expect(buf, 7, 1, 0x00);
+#elif defined(ABG_SYNC_PARK_ROW)
+    expect(buf, 7, 1, 0x7f); // the park row stays dark
+    expect(buf, FIRST / 128, 7 - FIRST / 128, 0xff);
+#elif defined(ABG_SYNC_SLOW_DRIVE)
+    expect(buf, 7, 1, 0xff);
+    expect(buf, 0, 7, 0xff);
+    expect(buf, 7, 1, 0x00);
+#endif
+}
+
+int main()
+{
+    a.startGray();
+#if defined(ABG_OVERLAY)
+    for(uint8_t p = 0; p < 3; ++p)
+        for(uint8_t j = 0; j < sizeof(overlay[p]); ++j)
+            overlay[p][j] = uint8_t(j * 37 + p * 101);
+#endif
+
+    uint32_t bad = 0;
+    for(uint16_t i = 0; i < 24; ++i)
+    {
+        uint8_t* b = a.getBuffer();
+        for(uint16_t j = 0; j < 1024; ++j)
+            b[j] = uint8_t(j * 7 + i * 13 + (j >> 7));
+#if defined(ABG_OVERLAY)
+        static uint8_t composited[1024];
+        memcpy(composited, b, sizeof(composited));
+        composite(composited, a.currentPlane());
+        a.setOverlay(&overlay[0][0], OVL_X, OVL_PAGE, OVL_W, OVL_PAGES, (i & 2) != 0);
+        expect_plane(composited);
+#else
+        expect_plane(b);
+#endif
+
+        uint8_t color = (i & 1) ? WHITE : BLACK;
+        Display::out_count = 0;
+        a.waitForNextPlane(color);
+
+        bool ok = Display::out_count == expected_count &&
+            memcmp(Display::out, expected, expected_count) == 0;
+        // WHITE sets every plane and BLACK none
+        uint8_t clear = color == WHITE ? 0xff : 0x00;
+        for(uint16_t j = FIRST; j < 1024; ++j)
+            if(b[j] != clear)
+                ok = false;
+        if(!ok && bad++ < 5)
+            printf("plane %u: paint stream or clear mismatch\n", (unsigned)i);
+    }
+    printf("%u bytes painted per plane\n", (unsigned)expected_count);
+    printf("check: %u mismatches\n", (unsigned)bad);
+    return bad != 0;
+}
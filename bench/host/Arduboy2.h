@@ -0,0 +1,75 @@
+// Stand-in for the Arduboy2 declarations that ArduboyG.h uses, for bench
+// builds without the Arduboy2 library: bench/display_host.cpp on a host
+// and bench/avr_cycles.cpp under simavr. Drawing and SPI calls do nothing;
+// ArduboyG.h supplies the AVR registers and ISR plumbing on hosts itself.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define WIDTH  128
+#define HEIGHT 64
+
+#define BLACK 0
+#define WHITE 1
+
+struct Print
+{
+    virtual size_t write(uint8_t) = 0;
+};
+
+struct Arduboy2Base
+{
+    static uint8_t sBuffer[WIDTH * HEIGHT / 8];
+
+    static uint8_t* getBuffer() { return sBuffer; }
+
+    static void boot() {}
+    static void bootSPI() {}
+    static void bootOLED() {}
+    static void bootPins() {}
+    static void bootPowerSaving() {}
+    static void setCPUSpeed8MHz() {}
+
+    static void LCDCommandMode() {}
+    static void LCDDataMode() {}
+    static void SPItransfer(uint8_t) {}
+
+    static void drawBitmap(int16_t, int16_t, uint8_t const*, uint8_t, uint8_t, uint8_t) {}
+    static void drawSlowXYBitmap(int16_t, int16_t, uint8_t const*, uint8_t, uint8_t, uint8_t) {}
+    static void drawCompressed(int16_t, int16_t, uint8_t const*, uint8_t) {}
+    static void drawPixel(int16_t, int16_t, uint8_t) {}
+    static void drawFastHLine(int16_t, int16_t, uint8_t, uint8_t) {}
+    static void drawFastVLine(int16_t, int16_t, uint8_t, uint8_t) {}
+    static void drawLine(int16_t, int16_t, int16_t, int16_t, uint8_t) {}
+    static void drawCircle(int16_t, int16_t, uint8_t, uint8_t) {}
+    static void drawTriangle(int16_t, int16_t, int16_t, int16_t, int16_t, int16_t, uint8_t) {}
+    static void drawRect(int16_t, int16_t, uint8_t, uint8_t, uint8_t) {}
+    static void drawRoundRect(int16_t, int16_t, uint8_t, uint8_t, uint8_t, uint8_t) {}
+    static void fillCircle(int16_t, int16_t, uint8_t, uint8_t) {}
+    static void fillTriangle(int16_t, int16_t, int16_t, int16_t, int16_t, int16_t, uint8_t) {}
+    static void fillRect(int16_t, int16_t, uint8_t, uint8_t, uint8_t) {}
+    static void fillRoundRect(int16_t, int16_t, uint8_t, uint8_t, uint8_t, uint8_t) {}
+    static void fillScreen(uint8_t) {}
+};
+
+struct Arduboy2 : Arduboy2Base, Print
+{
+    static constexpr uint8_t characterWidth = 5;
+    static constexpr uint8_t fullCharacterWidth = 6;
+    static constexpr uint8_t characterHeight = 8;
+    static constexpr uint8_t fullCharacterHeight = 9;
+
+    static bool    textRaw;
+    static bool    textWrap;
+    static int16_t cursor_x;
+    static int16_t cursor_y;
+    static uint8_t textColor;
+    static uint8_t textBackground;
+    static uint8_t textSize;
+
+    static void drawChar(int16_t, int16_t, unsigned char, uint8_t, uint8_t, uint8_t) {}
+    static void setTextColor(uint8_t c) { textColor = c; }
+    size_t write(uint8_t) override { return 1; }
+};
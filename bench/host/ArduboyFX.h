@@ -0,0 +1,23 @@
+// Stand-in for the ArduboyFX declarations that SpritesU.hpp uses, for
+// bench/spritesu_bench.cpp built with -DSPRITESU_FX on a host. FX data is
+// read from the array that FX::data points to; FX addresses are offsets
+// into it.
+
+#pragma once
+
+#include <stdint.h>
+
+// wide enough to carry a PROGMEM pointer, as SpritesU.hpp needs on hosts
+using uint24_t = uintptr_t;
+
+#define SFC_READ 0x03
+
+struct FX
+{
+    static inline uint8_t const* data;
+    static inline uint24_t address;
+
+    static void seekData(uint24_t a) { address = a; }
+    static uint8_t readPendingUInt8() { return data[address++]; }
+    static uint8_t readEnd() { return data[address++]; }
+};
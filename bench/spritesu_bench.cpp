@@ -0,0 +1,317 @@
+/*
+Host microbenchmark for the portable (non-AVR) SpritesU code paths.
+
+Build and run from the repository root:
+
+    g++ -O2 -o spritesu_bench bench/spritesu_bench.cpp
+    ./spritesu_bench
+
+Reports ns/draw and buffer bytes written/s for each draw method across
+sprite sizes, clip cases and sub-page y offsets. Numbers are only
+comparable between runs on the same host.
+
+Before timing, drawTilemap() is checked against a per-pixel reference
+and drawPlusMaskShared() against drawPlusMask() on the same sprite in
+the per-plane format, over a sweep of positions that includes clipping
+by every edge. Build with -DSPRITESU_BAND or -DABG_VIEWPORT_PAGES=4 (any
+of 1 to 7) to check the band and viewport targets too, and with
+-DSPRITESU_FX -Ibench/host to also check drawPlusMaskSharedFX() on the
+same data read as FX data; a guard page after the target buffer catches
+writes past its end. The run stops with a nonzero exit status
+on a mismatch.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+// minimal stand-in for the parts of Arduboy2 that SpritesU touches
+#define PROGMEM
+#define pgm_read_byte(p) (*(uint8_t const*)(p))
+// (each buffer has a guard page after it for the checks)
+struct Arduboy2Base
+{
+    static uint8_t sBuffer[1024 + 128];
+};
+uint8_t Arduboy2Base::sBuffer[1024 + 128];
+
+// and for the ArduboyG band buffer under SPRITESU_BAND
+#if defined(SPRITESU_BAND)
+namespace abg_detail
+{
+    uint8_t band_buffer[512 + 128];
+    uint8_t band_y;
+}
+#define TARGET_BUFFER abg_detail::band_buffer
+#define TARGET_SIZE 512
+#else
+#define TARGET_BUFFER Arduboy2Base::sBuffer
+#define TARGET_SIZE 1024
+#endif
+
+#define SPRITESU_IMPLEMENTATION
+#define SPRITESU_OVERWRITE
+#define SPRITESU_PLUSMASK
+#define SPRITESU_RECT
+#define SPRITESU_TILEMAP
+#include "../SpritesU.hpp"
+
+// enough for a 32x32 plus-mask sprite with 4 frames
+static uint8_t image[2 + 32 * 4 * 2 * 4];
+
+enum Method
+{
+    OVERWRITE,
+    PLUSMASK,
+    SELFMASK,
+    FILLRECT,
+};
+
+static char const* const METHOD_NAMES[] =
+{
+    "drawOverwrite",
+    "drawPlusMask",
+    "drawSelfMask",
+    "fillRect_i8",
+};
+
+struct ClipCase
+{
+    char const* name;
+    int16_t x, y; // position of the sprite with a sub-page y offset of zero
+};
+
+// positions are scaled by the sprite size so each case clips the same way
+static ClipCase const CLIP_CASES[] =
+{
+    { "inside", 48, 16 },
+    { "left",   -1, 16 },
+    { "top",    48, -1 },
+    { "right", 127, 16 },
+    { "bottom", 48, 63 },
+};
+
+// buffer bytes touched by a draw of w x h at (x, y), after clipping to
+// the target SpritesU draws into
+static uint32_t bytes_written(int16_t x, int16_t y, uint8_t w, uint8_t h)
+{
+    y -= SPRITESU_BAND_Y;
+    int16_t x0 = x < 0 ? 0 : x;
+    int16_t x1 = x + w > 128 ? 128 : x + w;
+    int16_t y0 = y < 0 ? 0 : y;
+    int16_t y1 = y + h > SPRITESU_HEIGHT ? SPRITESU_HEIGHT : y + h;
+    if(x1 <= x0 || y1 <= y0) return 0;
+    return uint32_t(x1 - x0) * uint32_t((y1 - 1) / 8 - y0 / 8 + 1);
+}
+
+static void draw(Method m, int16_t x, int16_t y, uint8_t w, uint8_t h, uint16_t frame)
+{
+    switch(m)
+    {
+    case OVERWRITE: SpritesU::drawOverwrite(x, y, image, frame); break;
+    case PLUSMASK:  SpritesU::drawPlusMask(x, y, image, frame);  break;
+    case SELFMASK:  SpritesU::drawSelfMask(x, y, image, frame);  break;
+    case FILLRECT:  SpritesU::fillRect_i8(int8_t(x), int8_t(y), w, h, frame & 1); break;
+    }
+}
+
+static void bench(Method m, uint8_t size, ClipCase const& c, uint8_t yoff)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr uint32_t ITERS = 200000;
+    constexpr uint8_t  RUNS  = 5;
+
+    // map the clip case onto this sprite size
+    int16_t x = c.x < 0 ? -size / 2 : c.x == 127 ? 128 - size / 2 : c.x;
+    int16_t y = c.y < 0 ? -size / 2 : c.y == 63  ?  64 - size / 2 : c.y;
+    y = int16_t((y & ~7) + yoff);
+
+    // e.g. an aligned 8x8 sprite cannot be clipped by the top edge
+    uint32_t bytes = bytes_written(x, y, size, size);
+    if(bytes == 0) return;
+
+    image[0] = size;
+    image[1] = size;
+
+    double best = 1e30;
+    for(uint8_t r = 0; r < RUNS; ++r)
+    {
+        auto t0 = clock::now();
+        for(uint32_t i = 0; i < ITERS; ++i)
+            draw(m, x, y, size, size, uint16_t(i & 3));
+        auto t1 = clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ITERS;
+        if(ns < best) best = ns;
+    }
+
+    printf("%-14s %2ux%-2u %-7s y&7=%u %9.1f ns/draw %9.1f MB/s\n",
+        METHOD_NAMES[m], size, size, c.name, yoff,
+        best, best > 0 ? bytes * 1e3 / best : 0.0);
+}
+
+// 4 tiles of 8x16 and a 5x3 map that uses all of them
+static uint8_t tiles[2 + 8 * 2 * 4];
+static uint8_t tilemap[5 * 3];
+
+static uint8_t target_ref[TARGET_SIZE + 128];
+
+// sets pixel (x, y) of the reference, clipped as SpritesU clips
+static void ref_pixel(int16_t x, int16_t y, bool on)
+{
+    y -= SPRITESU_BAND_Y;
+    if(x < 0 || x >= 128 || y < 0 || y >= SPRITESU_HEIGHT) return;
+    uint8_t* b = target_ref + (SPRITESU_BUFFER - TARGET_BUFFER) + (y >> 3) * 128 + x;
+    uint8_t bit = uint8_t(1 << (y & 7));
+    *b = on ? uint8_t(*b | bit) : uint8_t(*b & ~bit);
+}
+
+static void ref_tilemap(int16_t x, int16_t y, uint8_t map_w, uint8_t map_h)
+{
+    uint8_t tw = tiles[0], th = tiles[1];
+    for(uint8_t r = 0; r < map_h; ++r)
+    for(uint8_t c = 0; c < map_w; ++c)
+    {
+        uint8_t const* t = tiles + 2 + tilemap[r * map_w + c] * (th / 8) * tw;
+        for(uint8_t ty = 0; ty < th; ++ty)
+        for(uint8_t tx = 0; tx < tw; ++tx)
+            ref_pixel(x + c * tw + tx, y + r * th + ty,
+                (t[(ty >> 3) * tw + tx] >> (ty & 7)) & 1);
+    }
+}
+
+// draws the map at every position that overlaps the target, and some
+// that do not, and returns the number of positions that differ from
+// the reference or write outside the target
+static uint32_t check_tilemap()
+{
+    for(size_t i = 2; i < sizeof(tiles); ++i)
+        tiles[i] = uint8_t(i * 97 + 13);
+    tiles[0] = 8;
+    tiles[1] = 16;
+    for(size_t i = 0; i < sizeof(tilemap); ++i)
+        tilemap[i] = uint8_t(i * 3 % 4);
+
+    uint32_t bad = 0;
+    for(int16_t y = -56; y <= 72; ++y)
+    for(int16_t x = -48; x <= 136; x += 5)
+    {
+        for(size_t i = 0; i < sizeof(target_ref); ++i)
+            target_ref[i] = uint8_t(i * 31 + x + y);
+        memcpy(TARGET_BUFFER, target_ref, sizeof(target_ref));
+        SpritesU::drawTilemap(x, y, tilemap, 5, 3, tiles, 1, 0);
+        ref_tilemap(x, y, 5, 3);
+        if(memcmp(TARGET_BUFFER, target_ref, sizeof(target_ref)) != 0)
+        {
+            if(bad++ < 5)
+                printf("drawTilemap mismatch at x=%d y=%d\n", x, y);
+        }
+    }
+    return bad;
+}
+
+// a 12x16 sprite with 2 frames of 3 planes, in the plus-mask format and
+// in the shared-mask format of convert_sprite.py
+static uint8_t plus_mask[2 + 12 * 2 * 2 * 3 * 2];
+static uint8_t shared_mask[2 + 12 * 2 * 4 * 2];
+
+// returns the number of positions where drawPlusMaskShared() writes
+// different bytes than drawPlusMask()
+static uint32_t check_plus_mask_shared()
+{
+    constexpr uint8_t W = 12, H = 16, PLANES = 3, FRAMES = 2;
+    constexpr uint16_t PAGE_BYTES = W * H / 8;
+    plus_mask[0] = shared_mask[0] = W;
+    plus_mask[1] = shared_mask[1] = H;
+    for(uint8_t f = 0; f < FRAMES; ++f)
+    {
+        uint8_t* s = shared_mask + 2 + f * (PLANES + 1) * PAGE_BYTES;
+        for(uint16_t i = 0; i < PAGE_BYTES; ++i)
+            s[i] = uint8_t(i * 59 + f * 17 + 3);
+        for(uint8_t p = 0; p < PLANES; ++p)
+        {
+            uint8_t* d = plus_mask + 2 + (f * PLANES + p) * PAGE_BYTES * 2;
+            for(uint16_t i = 0; i < PAGE_BYTES; ++i)
+            {
+                s[(p + 1) * PAGE_BYTES + i] = uint8_t(i * 23 + p * 71 + f);
+                d[i * 2 + 0] = s[(p + 1) * PAGE_BYTES + i];
+                d[i * 2 + 1] = s[i];
+            }
+        }
+    }
+
+    uint32_t bad = 0;
+    for(int16_t y = -20; y <= 68; ++y)
+    for(int16_t x = -14; x <= 130; x += 3)
+    for(uint8_t f = 0; f < FRAMES; ++f)
+    for(uint8_t p = 0; p < PLANES; ++p)
+    {
+        for(size_t i = 0; i < sizeof(target_ref); ++i)
+            target_ref[i] = uint8_t(i * 31 + x + y);
+        memcpy(TARGET_BUFFER, target_ref, sizeof(target_ref));
+        SpritesU::drawPlusMask(x, y, plus_mask, f * PLANES + p);
+        memcpy(target_ref, TARGET_BUFFER, sizeof(target_ref));
+        for(size_t i = 0; i < sizeof(target_ref); ++i)
+            TARGET_BUFFER[i] = uint8_t(i * 31 + x + y);
+        SpritesU::drawPlusMaskShared(x, y, shared_mask, f, PLANES, p);
+        if(memcmp(TARGET_BUFFER, target_ref, sizeof(target_ref)) != 0)
+        {
+            if(bad++ < 5)
+                printf("drawPlusMaskShared mismatch at x=%d y=%d\n", x, y);
+        }
+#ifdef SPRITESU_FX
+        for(size_t i = 0; i < sizeof(target_ref); ++i)
+            TARGET_BUFFER[i] = uint8_t(i * 31 + x + y);
+        FX::data = shared_mask;
+        SpritesU::drawPlusMaskSharedFX(x, y, 0, f, PLANES, p);
+        if(memcmp(TARGET_BUFFER, target_ref, sizeof(target_ref)) != 0)
+        {
+            if(bad++ < 5)
+                printf("drawPlusMaskSharedFX mismatch at x=%d y=%d\n", x, y);
+        }
+#endif
+    }
+    return bad;
+}
+
+static bool check()
+{
+    uint32_t bad = 0;
+#if defined(SPRITESU_BAND)
+    for(uint8_t band = 0; band < 2; ++band)
+    {
+        abg_detail::band_y = band * 32;
+        bad += check_tilemap();
+        bad += check_plus_mask_shared();
+    }
+#else
+    bad += check_tilemap();
+    bad += check_plus_mask_shared();
+#endif
+    printf("check: %u mismatches\n", (unsigned)bad);
+    return bad == 0;
+}
+
+int main()
+{
+    if(!check())
+        return 1;
+
+    for(size_t i = 2; i < sizeof(image); ++i)
+        image[i] = uint8_t(i * 151 + 7);
+
+    static uint8_t const SIZES[] = { 8, 16, 32 };
+    static uint8_t const YOFFS[] = { 0, 1, 4, 7 };
+
+    for(uint8_t m = OVERWRITE; m <= FILLRECT; ++m)
+        for(uint8_t size : SIZES)
+            for(ClipCase const& c : CLIP_CASES)
+                for(uint8_t yoff : YOFFS)
+                    bench(Method(m), size, c, yoff);
+
+    // keep the buffer observable so the draws are not optimized away
+    uint32_t sum = 0;
+    for(uint8_t b : Arduboy2Base::sBuffer) sum += b;
+    printf("checksum %08x\n", (unsigned)sum);
+    return 0;
+}
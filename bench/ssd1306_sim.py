@@ -0,0 +1,329 @@
+'''
+Host-side model of ArduboyG driving an SSD1306, for checking plane timing
+without a physical Arduboy.
+
+The main loop (waitForNextPlane, doDisplay, render) is replayed against
+the timer ISR, producing the same command and data byte stream that
+doDisplay() sends for the chosen ABG_SYNC_* method, timestamped in CPU
+cycles. The display model applies that stream to GDDRAM (horizontal
+addressing, page range from 0x22) and scans it row by row, so every
+displayed frame can be reconstructed as the set of planes visible on its
+rows.
+
+For every plane period (ISR period, or phase 1 to phase 1 for three
+phase) the report counts:
+    missed  no full frame started, so the panel stayed parked
+    late    the frame started more than one row later than doDisplay()
+            would unpark the panel when woken on time
+    torn    the frame showed rows from more than one plane, or blank
+            rows other than the park row
+    twice   the same plane was scanned in consecutive frames
+
+Model assumptions (tune with the options below):
+    - The row counter wraps to 0 after the row equal to the mux ratio
+      written with 0xA8, or after row 63. Lowering the mux below the
+      current row lets the frame run on to row 63 first, which is how a
+      frame in progress ends in the park row (mux 0) for every method,
+      and how ABG_SYNC_THREE_PHASE turns an 8-row loop (mux 7) into a
+      full frame. A full frame scans rows 0 to 63 without wrapping.
+    - paint() masks are tracked per row: GDDRAM page 0 holds buffer page
+      7 bit-reversed, so row 0 is the park row that ABG_SYNC_PARK_ROW
+      keeps blank, and the 0xf0 mask of phase 2 fills rows 0-3.
+    - In ABG_SYNC_THREE_PHASE, OCR writes take effect one ISR later, so
+      phases 1 and 2 are followed by 4-line periods and phase 3 by a
+      64-line period.
+    - The panel row period defaults to slightly less than 1/64 of the
+      ISR period, as ABG_REFRESH_HZ is tuned for.
+    - paint() costs 18 cycles per byte (bench/avr_cycles.cpp measures
+      it); each command byte costs 28 cycles (SPItransfer plus call
+      overhead) and each send_cmds call 10 more.
+
+Examples:
+
+    python3 bench/ssd1306_sim.py --render 60000
+    python3 bench/ssd1306_sim.py --sync slow_drive --sweep
+    python3 bench/ssd1306_sim.py --sync three_phase --sweep
+'''
+
+import argparse
+
+F_CPU = 16000000
+PAINT_CYCLES = 18
+CMD_CYCLES = 28
+CMD_CALL_CYCLES = 10
+
+def timer_counter(hz):
+    return F_CPU // 64 // hz
+
+def bit_reverse(x):
+    return int('{:08b}'.format(x)[::-1], 2)
+
+def display_stream(sync, serial, plane_contrast, phase = None):
+    '''Yield (kind, value) for one doDisplay() call: kind is 'cmd',
+    'data' or 'call' (start of a send_cmds call); data values are the
+    serial of the plane that produced the byte and the GDDRAM rows of
+    the page that the paint() mask lets through.'''
+    def cmds(*c):
+        yield ('call', None)
+        for b in c:
+            yield ('cmd', b)
+    def paint(n, mask = 0xff):
+        rows = bit_reverse(mask)
+        for i in range(n):
+            yield ('data', (serial, rows))
+    if plane_contrast:
+        yield from cmds(0x81, 0)
+    if sync == 'park_row':
+        yield from paint(128, 0x7f)
+        yield from cmds(0xA8, 63)
+        yield from paint(128 * 7)
+        yield from cmds(0xA8, 0)
+    elif sync == 'slow_drive':
+        yield from cmds(0x22, 0, 7, 0x8D, 0x00, 0xD5, 0x0F, 0xD9, 0xFF)
+        yield from paint(128)
+        yield from cmds(0xA8, 63, 0x8D, 0x14, 0xD9, 0x31, 0xD5, 0xF0)
+        yield from paint(128 * 7)
+        yield from cmds(0xA8, 0)
+        yield from paint(128, 0x00)
+    elif sync == 'three_phase':
+        if phase == 1:
+            yield from cmds(0xA8, 7, 0x22, 0, 7)
+        elif phase == 2:
+            yield from paint(128, 0xf0)
+            yield from cmds(0x22, 0, 7)
+        elif phase == 3:
+            yield from cmds(0x22, 0, 7)
+            yield from paint(128)
+            yield from cmds(0xA8, 0)
+            yield from paint(128 * 7)
+            yield from paint(128, 0x00)
+
+def unpark(sync):
+    '''The command that starts the displayed frame, the phase that sends
+    it and the rows scanned from there before the full frame starts'''
+    if sync == 'three_phase':
+        return (0xA8, 7), 1, 8
+    return (0xA8, 63), None, 0
+
+def unpark_offset(sync, plane_contrast):
+    '''Cycles from the start of doDisplay() to the end of its unpark
+    command'''
+    cmd, phase, lead = unpark(sync)
+    t = 0
+    last = None
+    for kind, value in display_stream(sync, 0, plane_contrast, phase):
+        if kind == 'call':
+            t += CMD_CALL_CYCLES
+            continue
+        t += PAINT_CYCLES if kind == 'data' else CMD_CYCLES
+        if kind == 'cmd' and (last, value) == cmd:
+            return t
+        last = value if kind == 'cmd' else None
+    return t
+
+def isr_schedule(sync, hz, periods):
+    '''Return (times, phases) of the frame ISRs; phases are None
+    except for three phase'''
+    period = timer_counter(hz) * 64
+    if sync != 'three_phase':
+        return [k * period for k in range(1, periods + 1)], [None] * periods
+    short = ((timer_counter(hz) >> 4) + 1) * 64
+    times, phases = [], []
+    t = 0
+    for k in range(periods):
+        phase = k % 3 + 1
+        t += period if phase == 1 else short
+        times.append(t)
+        phases.append(phase)
+    return times, phases
+
+def run_cpu(sync, hz, periods, render, plane_contrast):
+    '''Replay the main loop; return (isr_times, isr_phases, events) where
+    events are (cycle, kind, value) tuples of the SPI stream.'''
+    isr_times, isr_phases = isr_schedule(sync, hz, periods)
+    events = []
+    t = 0
+    serial = 0
+    k = 0
+    while k < len(isr_times):
+        while k < len(isr_times):
+            # waitForNextPlane: sleep until the ISR sets needs_display;
+            # ISRs that fired meanwhile coalesce into one wakeup, and
+            # doDisplay() sees the phase of the last one
+            if t < isr_times[k]:
+                t = isr_times[k]
+            while k + 1 < len(isr_times) and isr_times[k + 1] <= t:
+                k += 1
+            phase = isr_phases[k]
+            k += 1
+            # doDisplay
+            for kind, value in display_stream(sync, serial, plane_contrast, phase):
+                if kind == 'call':
+                    t += CMD_CALL_CYCLES
+                    continue
+                events.append((t, kind, value))
+                t += PAINT_CYCLES if kind == 'data' else CMD_CYCLES
+            if phase is None:
+                break
+            # three phase waits again unless the phase is now 3
+            j = k
+            while j < len(isr_times) and isr_times[j] <= t:
+                j += 1
+            if isr_phases[j - 1] == 3:
+                break
+        serial += 1
+        t += render(serial)
+    return isr_times, isr_phases, events
+
+class Panel:
+    def __init__(self):
+        self.gddram = [[None] * 128 for r in range(64)]
+        self.page = 0
+        self.col = 0
+        self.page_lo = 0
+        self.page_hi = 7
+        self.mux = 0
+        self.pending = []
+
+    def apply(self, kind, value):
+        if kind == 'data':
+            serial, rows = value
+            for i in range(8):
+                self.gddram[self.page * 8 + i][self.col] = \
+                    serial if rows & (1 << i) else None
+            self.col += 1
+            if self.col == 128:
+                self.col = 0
+                self.page += 1
+                if self.page > self.page_hi:
+                    self.page = self.page_lo
+            return
+        self.pending.append(value)
+        c = self.pending
+        if c[0] == 0xA8 and len(c) == 2:
+            self.mux = c[1] & 63
+        elif c[0] == 0x22 and len(c) == 3:
+            self.page_lo = self.page = c[1] & 7
+            self.page_hi = c[2] & 7
+            self.col = 0
+        elif c[0] in (0x81, 0x8D, 0xD5, 0xD9) and len(c) == 2:
+            pass
+        elif c[0] in (0xA8, 0x22, 0x81, 0x8D, 0xD5, 0xD9):
+            return
+        self.pending = []
+
+def scan(isr_times, events, row_cycles):
+    '''Run the panel over the event stream; return the list of full
+    frames as (start_cycle, [set of serials per row]), where a blank
+    row holds None'''
+    panel = Panel()
+    frames = []
+    i = 0
+    t = 0
+    end = isr_times[-1] + isr_times[0]
+    row = 0
+    rows = []
+    start = 0
+    while t < end:
+        while i < len(events) and events[i][0] <= t:
+            panel.apply(events[i][1], events[i][2])
+            i += 1
+        if row == 0:
+            start = t
+            rows = []
+        rows.append(set(panel.gddram[row]))
+        t += row_cycles
+        if row == panel.mux or row == 63:
+            if row == 63:
+                frames.append((start, rows))
+            row = 0
+        else:
+            row += 1
+    return frames
+
+def analyse(sync, plane_times, frames, row_cycles, offset):
+    stats = dict(periods=0, missed=0, late=0, torn=0, twice=0)
+    lead = unpark(sync)[2]
+    # row 0 is the park row, which ArduboyG keeps blank
+    first = 1 if sync == 'park_row' else 0
+    fi = 0
+    last = None
+    for k in range(len(plane_times) - 1):
+        t0, t1 = plane_times[k], plane_times[k + 1]
+        stats['periods'] += 1
+        started = []
+        while fi < len(frames) and frames[fi][0] < t1:
+            if frames[fi][0] >= t0:
+                started.append(frames[fi])
+            fi += 1
+        if not started:
+            stats['missed'] += 1
+            continue
+        # a frame on time starts within one row of the unpark, after
+        # the rows scanned before the full frame
+        if started[0][0] - t0 > offset + (lead + 1) * row_cycles:
+            stats['late'] += 1
+        for start, rows in started:
+            shown = set().union(*rows[first:])
+            if len(shown) > 1:
+                stats['torn'] += 1
+            if last is not None and shown == last:
+                stats['twice'] += 1
+            last = shown
+    return stats
+
+def simulate(args, render_cycles):
+    period = timer_counter(args.hz) * 64
+    row_cycles = args.row_cycles or int(period * 0.98 / 64)
+    isr_times, isr_phases, events = run_cpu(
+        args.sync, args.hz, args.periods,
+        lambda serial: render_cycles, args.plane_contrast)
+    frames = scan(isr_times, events, row_cycles)
+    offset = unpark_offset(args.sync, args.plane_contrast)
+    unpark_phase = unpark(args.sync)[1]
+    plane_times = [t for t, p in zip(isr_times, isr_phases) if p == unpark_phase]
+    return analyse(args.sync, plane_times, frames, row_cycles, offset)
+
+def main():
+    ap = argparse.ArgumentParser(description = __doc__,
+        formatter_class = argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--sync', choices = ['park_row', 'slow_drive', 'three_phase'],
+        default = 'park_row')
+    ap.add_argument('--hz', type = int, default = 156,
+        help = 'ABG_REFRESH_HZ')
+    ap.add_argument('--periods', type = int, default = 60,
+        help = 'ISR periods to simulate')
+    ap.add_argument('--render', type = int, default = 0,
+        help = 'render() cycles per plane')
+    ap.add_argument('--row-cycles', type = int, default = 0,
+        help = 'panel row period in CPU cycles')
+    ap.add_argument('--plane-contrast', action = 'store_true',
+        help = 'model ABG_PLANE_CONTRAST commands')
+    ap.add_argument('--sweep', action = 'store_true',
+        help = 'find the largest render() that keeps every plane clean')
+    args = ap.parse_args()
+
+    period = timer_counter(args.hz) * 64
+    if args.sync == 'three_phase':
+        period += ((timer_counter(args.hz) >> 4) + 1) * 64 * 2
+    print('%s at %d Hz: plane period %d cycles' % (args.sync, args.hz, period))
+
+    if not args.sweep:
+        s = simulate(args, args.render)
+        print('render %d cycles: %d periods, %d missed, %d late, %d torn, %d twice' %
+            (args.render, s['periods'], s['missed'], s['late'], s['torn'], s['twice']))
+        return
+
+    lo, hi = 0, period * 2
+    while hi - lo > 64:
+        mid = (lo + hi) // 2
+        s = simulate(args, mid)
+        if s['missed'] or s['late'] or s['torn'] or s['twice']:
+            hi = mid
+        else:
+            lo = mid
+    print('largest clean render(): %d cycles (%.1f%% of the plane period)' %
+        (lo, 100.0 * lo / period))
+
+if __name__ == '__main__':
+    main()
@@ -3,6 +3,7 @@
 #define ABG_TIMER1
 #define ABG_SYNC_PARK_ROW
 #define ABG_PLANE_CONTRAST
+#define ABG_OVERLAY
 
 #include "ArduboyG.h"
 extern ArduboyGBase_Config<ABG_Mode::L4_Triplane> a;
@@ -10,6 +11,7 @@ extern ArduboyGBase_Config<ABG_Mode::L4_Triplane> a;
 #define SPRITESU_OVERWRITE
 #define SPRITESU_PLUSMASK
 #define SPRITESU_RECT
+#define SPRITESU_TILEMAP
 #include "SpritesU.hpp"
 
 extern uint8_t ox;
@@ -17,3 +19,4 @@ extern uint8_t oy;
 
 void update();
 void render();
+void render_setup();
@@ -1,6 +1,10 @@
 from PIL import Image
 
 def get_shade(rgba, shades, shade):
+    if shades == 8:
+        # binary-weighted planes for ABG_Mode::L8_Binary
+        level = (rgba[0] * 7 + 127) // 255
+        return (level >> shade) & 1
     w = (254 + shades) // shades
     b = (shade + 1) * w
     return 1 if rgba[0] >= b else 0
@@ -8,11 +12,13 @@ def get_shade(rgba, shades, shade):
 def get_mask(rgba):
     return 1 if rgba[3] >= 128 else 0
 
-def convert(fname, shades, sw = None, sh = None, num = None):
+# returns (bytes, masked), or None on error
+def convert_sprite(fname, shades, sw = None, sh = None, num = None):
 
-    if not (shades >= 2 and shades <= 4):
-        print('shades argument must be 2, 3, or 4')
+    if not (shades >= 2 and shades <= 4) and shades != 8:
+        print('shades argument must be 2, 3, 4, or 8')
         return None
+    planes = 3 if shades == 8 else shades - 1
 
     im = Image.open(fname).convert('RGBA')
     pixels = list(im.getdata())
@@ -41,7 +47,7 @@ def convert(fname, shades, sw = None, sh = None, num = None):
     for n in range(num):
         bx = (n % nw) * sw
         by = (n // nw) * sh
-        for shade in range(shades - 1):
+        for shade in range(planes):
             for p in range(sp):
                 for ix in range(sw):
                     x = bx + ix
@@ -59,11 +65,81 @@ def convert(fname, shades, sw = None, sh = None, num = None):
                     if masked:
                         bytes += bytearray([mask])
     
-    return bytes
+    return bytes, masked
+
+def convert(fname, shades, sw = None, sh = None, num = None):
+    r = convert_sprite(fname, shades, sw, sh, num)
+    return None if r is None else r[0]
+
+# Pre-shifted format for SpritesU::drawPreShifted: each frame becomes 8
+# plus-mask copies, copy s shifted down by s rows into sh + 8 rows, so
+# every y is drawn with page-aligned mask-and-store writes. Unmasked
+# sprites get a mask covering the sprite, so they draw as with
+# drawOverwrite. Costs 8 * (sh / 8 + 1) * sw * 2 bytes per frame.
+def preshift(bytes, masked):
+    w, h = bytes[0], bytes[1]
+    sp = (h + 7) // 8
+    step = 2 if masked else 1
+    frame_size = sp * w * step
+    out = bytearray([w, h])
+    for base in range(2, len(bytes), frame_size):
+        cols = []
+        for x in range(w):
+            image = 0
+            mask = 0 if masked else (1 << h) - 1
+            for p in range(sp):
+                i = base + (p * w + x) * step
+                image |= bytes[i] << (p * 8)
+                if masked:
+                    mask |= bytes[i + 1] << (p * 8)
+            cols.append((image, mask))
+        for shift in range(8):
+            for p in range(sp + 1):
+                for image, mask in cols:
+                    out += bytearray([
+                        ((image << shift) >> (p * 8)) & 0xff,
+                        ((mask << shift) >> (p * 8)) & 0xff])
+    return out
     
-def convert_header(fname, fout, sym, shades, sw = None, sh = None, num = None):
-    bytes = convert(fname, shades, sw, sh, num)
-    if bytes is None: return
+# Shared-mask format for SpritesU::drawPlusMaskShared: each frame stores
+# its mask once, then the image bytes of each plane, where the plus-mask
+# format repeats the mask for every plane. Saves (planes - 1) / (2 *
+# planes) of a masked grayscale sprite: a third for 4 shades.
+def share_mask(bytes, planes):
+    w, h = bytes[0], bytes[1]
+    page_bytes = ((h + 7) // 8) * w
+    frame_size = page_bytes * 2 * planes
+    out = bytearray([w, h])
+    for base in range(2, len(bytes), frame_size):
+        frame = bytes[base:base + frame_size]
+        # every plane has the same mask, so take the first
+        out += frame[1:page_bytes * 2:2]
+        for plane in range(planes):
+            out += frame[plane * page_bytes * 2:(plane + 1) * page_bytes * 2:2]
+    return out
+
+# sprite: also emit sym_SPRITE, a SpritesU::Sprite descriptor with the
+# size and format of each frame; SpritesU.hpp must be included first
+# preshifted: emit the format for SpritesU::drawPreShifted instead
+# shared_mask: emit the format for SpritesU::drawPlusMaskShared instead
+def convert_header(fname, fout, sym, shades, sw = None, sh = None, num = None, sprite = False,
+        preshifted = False, shared_mask = False):
+    r = convert_sprite(fname, shades, sw, sh, num)
+    if r is None: return
+    bytes, masked = r
+    if shared_mask:
+        if not masked:
+            print('%s: shared_mask needs an image with transparency' % fname)
+            return
+        if sprite:
+            print('%s: Sprite descriptors do not apply to shared-mask sprites' % fname)
+            sprite = False
+        bytes = share_mask(bytes, 3 if shades == 8 else shades - 1)
+    elif preshifted:
+        if sprite:
+            print('%s: Sprite descriptors do not apply to pre-shifted sprites' % fname)
+            sprite = False
+        bytes = preshift(bytes, masked)
     with open(fout, 'w') as f:
         f.write('#pragma once\n\n#include <stdint.h>\n#include <avr/pgmspace.h>\n\n')
         f.write('constexpr uint8_t %s[] PROGMEM =\n{\n' % sym)
@@ -75,10 +151,23 @@ def convert_header(fname, fout, sym, shades, sw = None, sh = None, num = None):
         if len(bytes) % 16 != 0:
             f.write('\n')
         f.write('};\n')
+        if sprite:
+            w, h = bytes[0], bytes[1]
+            f.write('\nconstexpr SpritesU::Sprite<%d, %d, SpritesU::%s> %s_SPRITE = { %s + 2 };\n' %
+                (w, h, 'MODE_PLUSMASK' if masked else 'MODE_OVERWRITE', sym, sym))
 
-def convert_bin(fname, fout, shades, sw = None, sh = None, num = None):
-    bytes = convert(fname, shades, sw, sh, num)
-    if bytes is None: return
+def convert_bin(fname, fout, shades, sw = None, sh = None, num = None, preshifted = False,
+        shared_mask = False):
+    r = convert_sprite(fname, shades, sw, sh, num)
+    if r is None: return
+    bytes, masked = r
+    if shared_mask:
+        if not masked:
+            print('%s: shared_mask needs an image with transparency' % fname)
+            return
+        bytes = share_mask(bytes, 3 if shades == 8 else shades - 1)
+    elif preshifted:
+        bytes = preshift(bytes, masked)
     with open(fout, 'wb') as f:
         f.write(bytes)
 
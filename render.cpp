@@ -5,34 +5,52 @@
 
 static uint8_t const TILEMAP[16 * 8] PROGMEM =
 {
-    18,19,146,59,134,155,170,6,171,37,37,38,27,17,19,43,
-    35,161,162,163,28,134,155,154,7,7,7,135,74,52,52,75,
-    27,177,178,179,11,11,134,135,81,74,52,52,219,50,50,51,
-    27,193,194,195,17,3,17,19,74,219,50,50,202,53,53,91,
-    28,209,128,211,17,35,142,74,219,202,53,53,91,156,157,158,
-    19,59,74,52,52,52,52,219,202,91,17,19,118,172,173,174,
-    1,3,90,203,50,50,202,53,91,118,6,6,187,204,205,206,
-    34,34,43,90,53,53,91,59,118,171,114,154,135,220,221,222
+    17,18,145,58,133,154,169,5,170,36,36,37,26,16,18,42,
+    34,160,161,162,27,133,154,153,6,6,6,134,73,51,51,74,
+    26,176,177,178,10,10,133,134,80,73,51,51,218,49,49,50,
+    26,192,193,194,16,2,16,18,73,218,49,49,201,52,52,90,
+    27,208,127,210,16,34,141,73,218,201,52,52,90,155,156,157,
+    18,58,73,51,51,51,51,218,201,90,16,18,117,171,172,173,
+    0,2,89,202,49,49,201,52,90,117,5,5,186,203,204,205,
+    33,33,42,89,52,52,90,58,117,170,113,153,134,219,220,221
 };
 
+// color legend, composited by paint() as each plane is sent:
+// 10x40 plus-mask frame per plane (data and mask interleaved) holding
+// swatches of DARK_GRAY, LIGHT_GRAY, WHITE at y = 10, 20, 30, lit on the
+// planes that the mode of a lights for each color
+template<uint8_t PLANE>
+static constexpr uint8_t legend_bits(uint8_t i, uint8_t iy = 0)
+{
+    return iy == 8 ? 0 : uint8_t(
+        ((i % 10 < 8 && ((i / 10) * 8 + iy) % 10 < 8 &&
+            decltype(a)::planeColor<PLANE>(((i / 10) * 8 + iy) / 10)) << iy) |
+        legend_bits<PLANE>(i, iy + 1));
+}
+#define LEGEND_COL(P, i) legend_bits<P>(i), 0xff
+#define LEGEND_PAGE(P, p) \
+    LEGEND_COL(P, p * 10 + 0), LEGEND_COL(P, p * 10 + 1), \
+    LEGEND_COL(P, p * 10 + 2), LEGEND_COL(P, p * 10 + 3), \
+    LEGEND_COL(P, p * 10 + 4), LEGEND_COL(P, p * 10 + 5), \
+    LEGEND_COL(P, p * 10 + 6), LEGEND_COL(P, p * 10 + 7), \
+    LEGEND_COL(P, p * 10 + 8), LEGEND_COL(P, p * 10 + 9)
+#define LEGEND_PLANE(P) { \
+    LEGEND_PAGE(P, 0), LEGEND_PAGE(P, 1), LEGEND_PAGE(P, 2), \
+    LEGEND_PAGE(P, 3), LEGEND_PAGE(P, 4) }
+static uint8_t const LEGEND[3][10 * 5 * 2] PROGMEM =
+{
+    LEGEND_PLANE(0), LEGEND_PLANE(1), LEGEND_PLANE(2),
+};
+
+void render_setup()
+{
+    a.setOverlay(&LEGEND[0][0], 0, 0, 10, 5, true);
+}
+
 void render()
 {
-    for(uint8_t y = 0; y < 8; ++y)
-    {
-        for(uint8_t x = 0; x < 16; ++x)
-        {
-            uint8_t tile = pgm_read_byte(&TILEMAP[y * 16 + x]) - 1;
-            uint16_t frame = tile * 3 + a.currentPlane();
-            SpritesU::drawOverwrite(
-                x * 16 - ox,
-                y * 16 - oy,
-                TILE_IMG,
-                frame);
-        }
-    }
-    
-    SpritesU::fillRect_i8(0, 0, 10, 40, a.color(BLACK));
-    SpritesU::fillRect_i8(0, 10, 8, 8, a.color(DARK_GRAY));
-    SpritesU::fillRect_i8(0, 20, 8, 8, a.color(LIGHT_GRAY));
-    SpritesU::fillRect_i8(0, 30, 8, 8, a.color(WHITE));
+    SpritesU::drawTilemap(
+        -ox, -oy,
+        TILEMAP, 16, 8,
+        TILE_IMG, 3, a.currentPlane());
 }